@@ -43,7 +43,14 @@ const std::string_view kIpv4NonDecimalUrls[] = {
     "http://00000.00000.00000.00000",
     "http://1.0x2.03.4",
     "http://0x1.2.0x3.4",
-    "http://0.01.0x02.3"};
+    "http://0.01.0x02.3",
+    "http://0x7f.1/",
+    "http://0X7F.0X1/",
+    "http://2130706433/",
+    "http://0x7F000001/",
+    "http://017700000001/",
+    "http://10.1:8080/",
+    "http://0xC0.0xA8.1.1./"};
 
 const std::string_view kDnsFallbackUrls[] = {
     "http://example.com",       "http://www.google.com",
@@ -8,6 +8,8 @@
  * - URL parsing via `ada::parse()` function
  * - Two URL representations: `ada::url` and `ada::url_aggregator`
  * - URL search parameters via `ada::url_search_params`
+ * - Matching of IP hosts against network prefixes via `ada::cidr_set`
+ * - Filtering of query parameters via `ada::query_filter`
  * - URL pattern matching via `ada::url_pattern` (URLPattern API)
  * - IDNA (Internationalized Domain Names) support
  *
@@ -29,6 +31,7 @@
 #define ADA_H
 
 #include "ada/ada_idna.h"
+#include "ada/idna_extensions.h"
 #include "ada/character_sets.h"
 #include "ada/character_sets-inl.h"
 #include "ada/checkers-inl.h"
@@ -50,6 +53,8 @@
 #include "ada/url_components-inl.h"
 #include "ada/url_aggregator.h"
 #include "ada/url_aggregator-inl.h"
+#include "ada/cidr_set.h"
+#include "ada/query_filter.h"
 #include "ada/url_search_params.h"
 #include "ada/url_search_params-inl.h"
 
@@ -5,6 +5,7 @@
 #ifndef ADA_CHECKERS_INL_H
 #define ADA_CHECKERS_INL_H
 
+#include <array>
 #include <bit>
 #include <string_view>
 #include "ada/checkers.h"
@@ -53,59 +54,149 @@ constexpr bool is_normalized_windows_drive_letter(
 ada_really_inline constexpr uint64_t try_parse_ipv4_fast(
     std::string_view input) noexcept {
   const char* p = input.data();
-  const char* const pend = p + input.size();
+  const char* pend = p + input.size();
+  // A single trailing dot is allowed and ignored.
+  if (p != pend && pend[-1] == '.') {
+    pend--;
+  }
 
-  uint32_t ipv4 = 0;
+  uint64_t ipv4 = 0;
+  uint64_t reserialize = 0;
 
   for (int i = 0; i < 4; ++i) {
-    if (p == pend) {
+    // Empty parts ("1..2", ".1") are never valid numbers.
+    if (p == pend || *p == '.') {
       return ipv4_fast_fail;
     }
 
-    uint32_t val;
-    char c = *p;
-    if (c >= '0' && c <= '9') {
-      val = c - '0';
+    uint64_t val = 0;
+    if (p[0] == '0' && pend - p >= 2 && to_lower(p[1]) == 'x') {
+      // Hexadecimal: "0x" on its own is zero.
+      p += 2;
+      reserialize = ipv4_fast_reserialize;
+      for (; p != pend && *p != '.'; p++) {
+        const uint8_t c = uint8_t(*p);
+        const uint8_t d = uint8_t(c - '0');
+        const uint8_t h = uint8_t(to_lower(char(c)) - 'a');
+        if (d <= 9) {
+          val = (val << 4) | d;
+        } else if (h <= 5) {
+          val = (val << 4) | (h + 10);
+        } else {
+          return ipv4_fast_fail;
+        }
+        if (val > 0xFFFFFFFF) return ipv4_fast_fail;
+      }
+    } else if (p[0] == '0' && pend - p >= 2 && p[1] != '.') {
+      // Octal: a leading zero followed by more digits.
       p++;
+      reserialize = ipv4_fast_reserialize;
+      for (; p != pend && *p != '.'; p++) {
+        const uint8_t d = uint8_t(*p - '0');
+        if (d > 7) return ipv4_fast_fail;
+        val = (val << 3) | d;
+        if (val > 0xFFFFFFFF) return ipv4_fast_fail;
+      }
     } else {
-      return ipv4_fast_fail;
+      for (; p != pend && *p != '.'; p++) {
+        const uint8_t d = uint8_t(*p - '0');
+        if (d > 9) return ipv4_fast_fail;
+        val = val * 10 + d;
+        if (val > 0xFFFFFFFF) return ipv4_fast_fail;
+      }
     }
 
-    if (p < pend) {
-      c = *p;
-      if (c >= '0' && c <= '9') {
-        if (val == 0) return ipv4_fast_fail;
-        val = val * 10 + (c - '0');
-        p++;
-        if (p < pend) {
-          c = *p;
-          if (c >= '0' && c <= '9') {
-            val = val * 10 + (c - '0');
-            p++;
-            if (val > 255) return ipv4_fast_fail;
-          }
-        }
+    if (p == pend) {
+      // The last number fills all the bits that are left: "127.1" is
+      // 127.0.0.1 and "2130706433" is 127.0.0.1 as well.
+      const int shift = 32 - 8 * i;
+      if (val >= (uint64_t(1) << shift)) {
+        return ipv4_fast_fail;
       }
+      if (i != 3) {
+        reserialize = ipv4_fast_reserialize;
+      }
+      return ((ipv4 << shift) | val) | reserialize;
     }
 
+    if (val > 255) {
+      return ipv4_fast_fail;
+    }
     ipv4 = (ipv4 << 8) | val;
+    p++;  // skip '.'
+  }
 
-    if (i < 3) {
-      if (p == pend || *p != '.') {
-        return ipv4_fast_fail;
+  // More than four numbers.
+  return ipv4_fast_fail;
+}
+
+constexpr bool parse_serialized_ipv6(
+    std::string_view input, std::array<uint16_t, 8>& address) noexcept {
+  if (input.size() < 2 || input.front() != '[' || input.back() != ']') {
+    return false;
+  }
+  input.remove_prefix(1);
+  input.remove_suffix(1);
+  address = {};
+  const size_t n = input.size();
+  size_t i = 0;
+  size_t piece_index = 0;
+  size_t compress = 8;  // 8 means there is no "::".
+  if (n >= 2 && input[0] == ':' && input[1] == ':') {
+    compress = 0;
+    i = 2;
+  }
+  while (i < n) {
+    if (piece_index == 8) {
+      return false;
+    }
+    uint32_t value = 0;
+    size_t length = 0;
+    for (; i < n && length < 4; i++, length++) {
+      const uint8_t d = uint8_t(input[i] - '0');
+      const uint8_t h = uint8_t(to_lower(input[i]) - 'a');
+      if (d <= 9) {
+        value = (value << 4) | d;
+      } else if (h <= 5) {
+        value = (value << 4) | (h + 10);
+      } else {
+        break;
       }
-      p++;
     }
-  }
-
-  if (p != pend) {
-    if (p == pend - 1 && *p == '.') {
-      return ipv4;
+    if (length == 0) {
+      return false;
+    }
+    address[piece_index++] = uint16_t(value);
+    if (i == n) {
+      break;
+    }
+    if (input[i] != ':') {
+      return false;
+    }
+    i++;
+    if (i < n && input[i] == ':') {
+      if (compress != 8) {
+        return false;
+      }
+      compress = piece_index;
+      i++;
+    } else if (i == n) {
+      return false;
     }
-    return ipv4_fast_fail;
   }
-
-  return ipv4;
+  if (compress == 8) {
+    return piece_index == 8;
+  }
+  if (piece_index == 8) {
+    return false;
+  }
+  // Move the pieces that follow "::" to the end of the address.
+  const size_t shift = 8 - piece_index;
+  for (size_t j = piece_index; j-- > compress;) {
+    address[j + shift] = address[j];
+    address[j] = 0;
+  }
+  return true;
 }
 
 }  // namespace ada::checkers
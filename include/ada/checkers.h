@@ -7,6 +7,7 @@
 
 #include "ada/common_defs.h"
 
+#include <array>
 #include <cstring>
 #include <string_view>
 
@@ -92,7 +93,10 @@ ada_really_inline constexpr bool is_ipv4(std::string_view view) noexcept;
  * Returns a bitset. If the first bit is set, then at least one character needs
  * percent encoding. If the second bit is set, a \\ is found. If the third bit
  * is set then we have a dot. If the fourth bit is set, then we have a percent
- * character.
+ * character. If the fifth bit is set, then at least one path segment starts
+ * with a dot (it follows a / or a \\, or it is the first character), so that
+ * the path may contain single-dot or double-dot segments. Inputs of 16 bytes
+ * or more are classified with SIMD instructions when available.
  */
 ada_really_inline constexpr uint8_t path_signature(
     std::string_view input) noexcept;
@@ -113,21 +117,55 @@ ada_really_inline constexpr bool verify_dns_length(
 
 /**
  * @private
- * Fast-path parser for pure decimal IPv4 addresses (e.g., "192.168.1.1").
- * Returns the packed 32-bit IPv4 address on success, or a value > 0xFFFFFFFF
- * to indicate failure (caller should fall back to general parser).
- * This is optimized for the common case where the input is a well-formed
- * decimal IPv4 address with exactly 4 octets.
+ * Fast-path parser for IPv4 addresses in any of the WHATWG number forms:
+ * dotted decimal ("192.168.1.1"), hexadecimal ("0xc0.0xa8.1.1"), octal
+ * ("0300.0250.1.1") and the one to three part short forms ("127.1",
+ * "2130706433"). A single trailing dot is accepted. The "0x" prefix and the
+ * hexadecimal digits are matched case-insensitively.
+ *
+ * Returns the packed 32-bit IPv4 address on success, possibly with the
+ * ipv4_fast_reserialize bit set, or ipv4_fast_fail to indicate failure
+ * (caller should fall back to general parser). When ipv4_fast_reserialize is
+ * not set, the input (minus a trailing dot) is already the canonical
+ * dotted-decimal serialization of the address and can be copied as is.
  */
 ada_really_inline constexpr uint64_t try_parse_ipv4_fast(
     std::string_view input) noexcept;
 
+/**
+ * @private
+ * The IPv6 parser of the URL specification: parses an IPv6 address, without
+ * the brackets, in any of its textual forms (e.g., "2001:DB8::1",
+ * "::ffff:1.2.3.4") into its eight 16-bit pieces.
+ * @return true on success, false if the input is not a valid IPv6 address.
+ * @see https://url.spec.whatwg.org/#concept-ipv6-parser
+ */
+bool parse_ipv6(std::string_view input,
+                std::array<uint16_t, 8>& address) noexcept;
+
+/**
+ * @private
+ * Parses a bracketed IPv6 host as produced by serializers::ipv6 (e.g.,
+ * "[2001:db8::1]") into its eight 16-bit pieces. Only the hexadecimal piece
+ * syntax with at most one "::" is accepted: this is meant for hosts that
+ * were already validated and serialized by the URL parser.
+ * @return true on success, false if the input is not in that form.
+ */
+constexpr bool parse_serialized_ipv6(std::string_view input,
+                                     std::array<uint16_t, 8>& address) noexcept;
+
 /**
  * Sentinel value indicating try_parse_ipv4_fast() did not succeed.
- * Any value > 0xFFFFFFFF indicates the fast path should not be used.
+ * A result with this bit set indicates the fast path should not be used.
  */
 constexpr uint64_t ipv4_fast_fail = uint64_t(1) << 32;
 
+/**
+ * Set by try_parse_ipv4_fast() next to a valid address when the input is not
+ * in canonical dotted-decimal form, so the host must be reserialized.
+ */
+constexpr uint64_t ipv4_fast_reserialize = uint64_t(1) << 33;
+
 }  // namespace ada::checkers
 
 #endif  // ADA_CHECKERS_H
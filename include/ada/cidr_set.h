@@ -0,0 +1,149 @@
+/**
+ * @file cidr_set.h
+ * @brief Matching of IP hosts against sets of network prefixes.
+ *
+ * This file provides the `cidr_set` class which stores IPv4 and IPv6 network
+ * prefixes (CIDR blocks such as "10.0.0.0/8" or "fe80::/10") and checks
+ * whether the host of a parsed URL falls within any of them.
+ */
+#ifndef ADA_CIDR_SET_H
+#define ADA_CIDR_SET_H
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "ada/common_defs.h"
+#include "ada/url_base.h"
+
+namespace ada {
+
+/**
+ * @brief A set of IPv4 and IPv6 network prefixes with fast membership tests.
+ *
+ * The prefixes are stored in a compressed multibit trie (a poptrie): every
+ * node consumes 6 bits of the address and keeps two 64-bit bitmaps, one for
+ * the slots fully covered by a prefix and one for the slots that have a
+ * child. Children are stored contiguously so that the position of a child is
+ * found with a population count. Matching an IPv4 address visits at most 6
+ * nodes, matching an IPv6 address at most 22.
+ *
+ * IPv4-mapped IPv6 addresses (::ffff:a.b.c.d) are also matched against the
+ * IPv4 prefixes.
+ *
+ * Adding prefixes is not thread-safe, but a cidr_set that is no longer
+ * modified may be queried from several threads.
+ *
+ * @code
+ * ada::cidr_set blocked;
+ * blocked.add("127.0.0.0/8");
+ * blocked.add("10.0.0.0/8");
+ * blocked.add("::1/128");
+ * auto url = ada::parse("http://0x7f.1/");
+ * if (url && blocked.contains(*url)) { ... }
+ * @endcode
+ */
+struct cidr_set {
+  cidr_set() = default;
+  cidr_set(const cidr_set& u) = default;
+  cidr_set(cidr_set&& u) noexcept = default;
+  cidr_set& operator=(cidr_set&& u) noexcept = default;
+  cidr_set& operator=(const cidr_set& u) = default;
+  ~cidr_set() = default;
+
+  /**
+   * Adds a prefix written as "address/length" (e.g., "192.168.0.0/16",
+   * "2001:db8::/32"). Without a length, the address itself is added. IPv4
+   * addresses must be in dotted-decimal form. Bits beyond the prefix length
+   * are ignored.
+   * @return `true` on success, `false` if the input is not a valid prefix.
+   */
+  bool add(std::string_view cidr);
+
+  /**
+   * Adds an IPv4 prefix. Bits beyond the prefix length are ignored.
+   * @return `true` on success, `false` if prefix_length is larger than 32.
+   */
+  bool add(uint32_t ipv4, uint8_t prefix_length);
+
+  /**
+   * Adds an IPv6 prefix. Bits beyond the prefix length are ignored.
+   * @return `true` on success, `false` if prefix_length is larger than 128.
+   */
+  bool add(const std::array<uint16_t, 8>& ipv6, uint8_t prefix_length);
+
+  /**
+   * Checks whether the IPv4 address belongs to one of the prefixes.
+   */
+  [[nodiscard]] bool contains(uint32_t ipv4) const noexcept;
+
+  /**
+   * Checks whether the IPv6 address belongs to one of the prefixes.
+   */
+  [[nodiscard]] bool contains(
+      const std::array<uint16_t, 8>& ipv6) const noexcept;
+
+  /**
+   * Checks whether the host of the URL is an IPv4 or IPv6 address that belongs
+   * to one of the prefixes. Domain names never match. The address is parsed
+   * from the hostname on each call, see url_aggregator::get_ipv6_address;
+   * use the overloads taking an address to check it several times.
+   */
+  template <class result_type>
+    requires std::derived_from<result_type, url_base>
+  [[nodiscard]] bool contains(const result_type& url) const noexcept {
+    if (url.host_type == url_host_type::IPV4) {
+      auto address = url.get_ipv4_address();
+      return address.has_value() && contains(*address);
+    }
+    if (url.host_type == url_host_type::IPV6) {
+      auto address = url.get_ipv6_address();
+      return address.has_value() && contains(*address);
+    }
+    return false;
+  }
+
+  /**
+   * Returns the number of prefixes that were added.
+   */
+  [[nodiscard]] size_t size() const noexcept { return prefix_count; }
+
+  /**
+   * Returns true if no prefix was added.
+   */
+  [[nodiscard]] bool empty() const noexcept { return prefix_count == 0; }
+
+ private:
+  struct node {
+    // Slots entirely covered by a prefix.
+    uint64_t leaf{};
+    // Slots that have a child node.
+    uint64_t children{};
+    // Index of the first child, the children are stored contiguously.
+    uint32_t base{};
+  };
+
+  struct trie {
+    std::vector<node> nodes{node{}};
+    // Number of nodes that are no longer reachable.
+    size_t garbage{};
+
+    void insert(uint64_t high, uint64_t low, size_t length);
+    [[nodiscard]] bool lookup(uint64_t high, uint64_t low) const noexcept;
+
+   private:
+    uint32_t add_child(uint32_t index, uint64_t bit);
+    void compact();
+  };
+
+  trie ipv4_trie{};
+  trie ipv6_trie{};
+  size_t prefix_count{};
+};  // cidr_set
+
+}  // namespace ada
+
+#endif  // ADA_CIDR_SET_H
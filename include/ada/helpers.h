@@ -65,6 +65,24 @@ ada_really_inline bool shorten_path(std::string& path, ada::scheme::type type);
 ada_really_inline bool shorten_path(std::string_view& path,
                                     ada::scheme::type type);
 
+/**
+ * @private
+ *
+ * Appends the segments of the input to the path that starts at path_start in
+ * output, percent-encoding them when needs_percent_encoding is set, and
+ * resolves the single-dot and double-dot segments (including the Windows
+ * drive letter rules of file URLs) in a single pass. The separators, dots and
+ * "%2e" sequences are located as bitmasks, 64 bytes at a time, and a
+ * double-dot segment only scans the segment that it removes.
+ *
+ * @see https://url.spec.whatwg.org/#path-state
+ */
+ada_really_inline void append_normalized_path(std::string_view input,
+                                              ada::scheme::type type,
+                                              bool needs_percent_encoding,
+                                              std::string& output,
+                                              size_t path_start);
+
 /**
  * @private
  *
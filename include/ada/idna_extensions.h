@@ -0,0 +1,144 @@
+/**
+ * @file idna_extensions.h
+ * @brief Additions of ada to the ada-idna API.
+ *
+ * `ada/ada_idna.h` and `src/ada_idna.cpp` are an unmodified copy of the
+ * ada-idna amalgamation. The functions declared here are built on its public
+ * API: conversions that reuse caller-provided scratch space, an optional
+ * cache of their results and batch conversions.
+ */
+#ifndef ADA_IDNA_EXTENSIONS_H
+#define ADA_IDNA_EXTENSIONS_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ada/ada_idna.h"
+
+namespace ada::idna {
+
+/**
+ * Appends the UTF-32 form of the UTF-8 input to out. The input is validated
+ * and converted in a single pass: out is first grown by input.size(), which
+ * bounds the number of code points, then shrunk.
+ *
+ * @return false, leaving out unchanged, if the input is not valid UTF-8.
+ */
+bool utf8_to_utf32(std::string_view input, std::u32string& out);
+
+/**
+ * Appends the UTF-8 form of the UTF-32 input to out in a single pass.
+ *
+ * @return false, leaving out unchanged, if the input holds a surrogate or a
+ *         value beyond U+10FFFF.
+ */
+bool utf32_to_utf8(std::u32string_view input, std::string& out);
+
+/**
+ * Scratch space for to_ascii and to_unicode. The buffers keep their capacity
+ * from one call to the next: a caller that keeps a scratch_buffers around and
+ * converts many domains stops allocating once the buffers fit its labels.
+ */
+struct scratch_buffers {
+  std::u32string utf32{};
+  std::u32string mapped{};
+  std::u32string tmp_buffer{};
+  std::u32string post_map{};
+};
+
+/**
+ * Same as `ada::idna::to_ascii(std::string_view)`, but appends the result to
+ * out and uses the given scratch space. The domain is processed one label at
+ * a time: the ASCII labels are only lowercased, and only the labels with
+ * non-ASCII code points are mapped, normalized and encoded.
+ *
+ * @return false on error, in which case out is left unchanged.
+ */
+bool to_ascii(std::string_view ut8_string, std::string& out,
+              scratch_buffers& scratch);
+
+/**
+ * Same as `ada::idna::to_unicode(std::string_view)`, but appends the result
+ * to out and uses the given scratch space.
+ */
+void to_unicode(std::string_view input, std::string& out,
+                scratch_buffers& scratch);
+
+/**
+ * The to_ascii and to_unicode overloads above, which the URL parser uses, can
+ * keep their recent results in a process-wide cache, so that the same hosts
+ * are not mapped, normalized and encoded over and over. to_ascii caches the
+ * domains with non-ASCII characters and to_unicode the domains with "xn--"
+ * labels; other inputs are cheap to convert and bypass the cache. The cache
+ * is disabled by default.
+ *
+ * The cache is safe to use from several threads: it is split into shards
+ * that each have their own lock.
+ */
+struct cache_statistics {
+  size_t hits{};
+  size_t misses{};
+  // Number of results currently held.
+  size_t size{};
+  size_t capacity{};
+};
+
+/**
+ * Keeps about capacity results for each of to_ascii and to_unicode, and no
+ * fewer than a few dozen when enabled. A capacity of zero disables the cache.
+ * Changing the capacity clears the cache and its counters.
+ */
+void set_cache_capacity(size_t capacity);
+
+size_t get_cache_capacity() noexcept;
+
+/**
+ * Drops the cached results and resets the counters.
+ */
+void clear_cache();
+
+cache_statistics get_to_ascii_cache_statistics();
+cache_statistics get_to_unicode_cache_statistics();
+
+/**
+ * Results of a batch conversion, packed into a single buffer: the result for
+ * the i-th input is data[offsets[i], offsets[i + 1]).
+ */
+struct batch_results {
+  std::string data{};
+  std::vector<size_t> offsets{};
+
+  [[nodiscard]] size_t size() const noexcept {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+  }
+
+  [[nodiscard]] std::string_view operator[](size_t index) const noexcept {
+    return std::string_view(data).substr(
+        offsets[index], offsets[index + 1] - offsets[index]);
+  }
+};
+
+/**
+ * Converts each input as to_ascii does and replaces the content of out with
+ * the results; a failed conversion gives an empty result. The scratch space
+ * and the output buffers are shared by the whole batch, and the inputs that
+ * are plain ASCII domains without punycode labels are only lowercased.
+ *
+ * @return The number of failed conversions.
+ */
+size_t to_ascii_batch(std::span<const std::string_view> inputs,
+                      batch_results& out);
+
+/**
+ * Converts each input as to_unicode does and replaces the content of out
+ * with the results. Inputs without "xn--" are copied as is.
+ */
+void to_unicode_batch(std::span<const std::string_view> inputs,
+                      batch_results& out);
+
+}  // namespace ada::idna
+
+#endif  // ADA_IDNA_EXTENSIONS_H
@@ -8,12 +8,32 @@
 
 #include "ada/expected.h"
 #include "ada/implementation.h"
+#include "ada/parser.h"
 
 #include <variant>
 #include <string_view>
 
 namespace ada {
 
+template <component components>
+ada_warn_unused ada::result<url_aggregator> parse_components(
+    std::string_view input, const url_aggregator* base_url) {
+  constexpr uint8_t authority_components =
+      uint8_t(component::protocol | component::host | component::port);
+  if constexpr ((uint8_t(components) & ~authority_components) == 0) {
+    // The validation-only mode of the parser (also used by can_parse) stores
+    // the scheme, the host and the port, and returns before the path.
+    url_aggregator u =
+        parser::parse_url_impl<url_aggregator, false>(input, base_url);
+    if (!u.is_valid) {
+      return tl::unexpected(errors::type_error);
+    }
+    return u;
+  } else {
+    return parse<url_aggregator>(input, base_url);
+  }
+}
+
 #if ADA_INCLUDE_URL_PATTERN
 template <url_pattern_regex::regex_concept regex_provider>
 ada_warn_unused tl::expected<url_pattern<regex_provider>, errors>
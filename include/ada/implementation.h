@@ -11,6 +11,8 @@
 #ifndef ADA_IMPLEMENTATION_H
 #define ADA_IMPLEMENTATION_H
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <optional>
@@ -101,6 +103,239 @@ extern template ada::result<url> parse<url>(std::string_view input,
 extern template ada::result<url_aggregator> parse<url_aggregator>(
     std::string_view input, const url_aggregator* base_url);
 
+/**
+ * Parses a URL string into an existing `ada::url_aggregator`.
+ *
+ * The result is the same as the one of `ada::parse`, but the buffer of
+ * `dst` is reused: once `dst` has enough capacity, parsing does not
+ * allocate memory for the URL itself. This is useful when URLs are parsed
+ * in a loop.
+ *
+ * @param dst The URL that receives the result. Its previous content is
+ *        discarded. On failure, `dst.is_valid` is false and the other
+ *        components of `dst` are unspecified.
+ * @param input The URL string to parse. Must be valid ASCII or UTF-8.
+ * @param base_url Optional pointer to a base URL. It may be `&dst`, in
+ *        which case the buffer of `dst` is not reused.
+ *
+ * @return `true` on success, `false` otherwise.
+ *
+ * @example
+ * ```cpp
+ * ada::url_aggregator url;
+ * for (std::string_view input : inputs) {
+ *     if (ada::parse_into(url, input)) {
+ *         std::cout << url.get_hostname();
+ *     }
+ * }
+ * ```
+ */
+bool parse_into(url_aggregator& dst, std::string_view input,
+                const url_aggregator* base_url = nullptr);
+
+/**
+ * Builds a URL from the components of an HTTP/2 or HTTP/3 request: the
+ * :scheme, :authority and :path pseudo-header fields.
+ *
+ * The result is the same as parsing scheme + "://" + authority +
+ * path_and_query with `ada::parse`, without building that string: each part
+ * goes through the step of the parser that handles it and is written once
+ * into the buffer of the result.
+ *
+ * As with `ada::parse`, C0 controls and spaces are trimmed from the start of
+ * the scheme and from the end of path_and_query (or of the authority, when
+ * path_and_query is empty or made of them only).
+ *
+ * The parse fails if a part would not stay in its role once concatenated:
+ * the authority may not contain credentials ('@', which HTTP/2 and HTTP/3
+ * forbid) or a '/', '?' or '#'. The path must be empty or start with '/' or
+ * '?'. The "file" scheme is not supported.
+ *
+ * @example
+ * ```cpp
+ * auto url = ada::parse_from_parts("https", "EXAMPLE.com:443", "/a/../b?q");
+ * url->get_href();  // "https://example.com/b?q"
+ * ```
+ */
+ada_warn_unused ada::result<url_aggregator> parse_from_parts(
+    std::string_view scheme, std::string_view authority,
+    std::string_view path_and_query);
+
+/**
+ * The forms of the request-target of an HTTP/1.1 request line.
+ * @see https://www.rfc-editor.org/rfc/rfc9112#section-3.2
+ */
+enum class request_target_form : uint8_t {
+  origin,     // "/path?query", the host comes from the Host header
+  absolute,   // "http://example.com/path", used with proxies
+  authority,  // "example.com:443", used with CONNECT
+  asterisk,   // "*", used with OPTIONS
+};
+
+/**
+ * Classifies the request-target of an HTTP/1.1 request with the given method.
+ * Only CONNECT uses the authority-form, and it uses nothing else, so the
+ * method decides it: "mailto:1234" is an absolute-form target even though it
+ * looks like a host and a port. Otherwise, a target that starts with '/' is in
+ * origin-form, "*" is in asterisk-form for OPTIONS (the only method that uses
+ * it) and anything else is taken to be in absolute-form: "*" with another
+ * method is not a valid URL. Methods are case-sensitive.
+ *
+ * @see https://www.rfc-editor.org/rfc/rfc9112#section-3.2.3
+ * @see https://www.rfc-editor.org/rfc/rfc9112#section-3.2.4
+ */
+[[nodiscard]] request_target_form get_request_target_form(
+    std::string_view method, std::string_view target) noexcept;
+
+/**
+ * Builds the target URI of an HTTP/1.1 request from its method, its
+ * request-target, the value of its Host header and the scheme of the
+ * connection ("http" or "https").
+ *
+ * This is a convenience function: it classifies the target with
+ * `ada::get_request_target_form` and forwards to `ada::parse_from_parts` or
+ * `ada::parse`, so it is exactly as fast as those.
+ *
+ * - origin-form: the path and query are normalized and appended to the
+ *   host, see `ada::parse_from_parts`. No URL string is built.
+ * - absolute-form: the target is parsed as is, the Host header is ignored.
+ * - authority-form: the target is the authority. The path of the result is
+ *   "/", as for any URL with a special scheme and an empty path.
+ * - asterisk-form: the Host header is the authority and the path is "/".
+ *
+ * @see https://www.rfc-editor.org/rfc/rfc9112#section-3.3
+ *
+ * @example
+ * ```cpp
+ * auto url =
+ *     ada::parse_request_target("GET", "/a/./b?q", "example.com", "https");
+ * url->get_href();  // "https://example.com/a/b?q"
+ * ```
+ */
+ada_warn_unused ada::result<url_aggregator> parse_request_target(
+    std::string_view method, std::string_view target,
+    std::string_view host_header, std::string_view scheme);
+
+/**
+ * Options for a single call to `ada::parse`.
+ *
+ * Unlike `set_max_input_length()`, which changes a process-wide setting,
+ * these options only apply to the call they are passed to. The setters of
+ * the resulting URL still use `get_max_input_length()`.
+ *
+ * The default options give the same result as `ada::parse` without
+ * options, except for the length limit which does not depend on
+ * `get_max_input_length()`.
+ */
+struct parse_options {
+  /**
+   * Maximum length of the input and of the resulting href, in bytes.
+   */
+  uint32_t max_input_length = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * The caller guarantees that the input has no leading or trailing C0
+   * control or space, so the parser does not look for them. If the
+   * guarantee does not hold, the result is unspecified (but safe).
+   */
+  bool input_is_trimmed = false;
+
+  /**
+   * Hosts of special URLs that contain non-ASCII characters are rejected
+   * instead of going through IDNA processing (domain to ASCII). Hosts that
+   * contain a '%' are rejected as well, whatever the escapes decode to:
+   * the check is made on the host as written, during the scan that
+   * classifies it, and the host is never percent-decoded.
+   */
+  bool reject_non_ascii_hosts = false;
+
+  /**
+   * The caller only expects IPv4 addresses in dotted-decimal form (e.g.,
+   * 127.0.0.1), so the parser skips the other IPv4 number forms: a host
+   * that ends in a number but is not four decimal numbers, such as
+   * 0x7f.1, 0177.0.0.1 or 2130706433, is rejected without being parsed.
+   * The form is checked after percent-decoding and IDNA mapping, so
+   * %31%32%37.0.0.1 or 127.0.0.1 in fullwidth digits are accepted.
+   */
+  bool dotted_decimal_ipv4_only = false;
+};
+
+/**
+ * Parses a URL string according to the WHATWG URL Standard, with options.
+ *
+ * @see ada::parse(std::string_view, const result_type*)
+ * @see ada::parse_options
+ *
+ * @example
+ * ```cpp
+ * ada::parse_options options;
+ * options.max_input_length = 2048;
+ * options.reject_non_ascii_hosts = true;
+ * auto url = ada::parse("https://example.com/", options);
+ * ```
+ */
+template <class result_type = ada::url_aggregator>
+ada_warn_unused ada::result<result_type> parse(
+    std::string_view input, const parse_options& options,
+    const result_type* base_url = nullptr);
+
+extern template ada::result<url> parse<url>(std::string_view input,
+                                            const parse_options& options,
+                                            const url* base_url);
+extern template ada::result<url_aggregator> parse<url_aggregator>(
+    std::string_view input, const parse_options& options,
+    const url_aggregator* base_url);
+
+/**
+ * URL components that can be requested from `ada::parse_components`. They
+ * can be combined with the | operator.
+ */
+enum class component : uint8_t {
+  protocol = 1,
+  credentials = 2,  // username and password
+  host = 4,         // hostname and host type
+  port = 8,
+  pathname = 16,
+  search = 32,
+  hash = 64,
+  all = 127,
+};
+
+constexpr component operator|(component a, component b) noexcept {
+  return component(uint8_t(a) | uint8_t(b));
+}
+
+/**
+ * Parses a URL string, but only computes the requested components.
+ *
+ * When only the protocol, the host and the port are requested, the parser
+ * stops once the authority is done. It skips the credentials, the path
+ * normalization, the percent-encoding of the query and of the fragment, and
+ * most of the buffer assembly. Any input that `ada::parse` rejects because
+ * of its scheme or its authority (e.g., an invalid host or port) is still
+ * rejected. Later parts of a URL cannot make the parse fail.
+ *
+ * In the result, the components that were not requested may be missing or
+ * empty, and `get_href()` may not be the full URL. If other components are
+ * requested, this function does a full parse.
+ *
+ * @tparam components The requested components, e.g.,
+ *         `ada::component::protocol | ada::component::host`.
+ *
+ * @example
+ * ```cpp
+ * auto url = ada::parse_components<ada::component::protocol |
+ *                                  ada::component::host>(
+ *     "https://EXAMPLE.com/a/very/long/path?with=query");
+ * if (url) {
+ *     std::cout << url->get_hostname(); // "example.com"
+ * }
+ * ```
+ */
+template <component components>
+ada_warn_unused ada::result<url_aggregator> parse_components(
+    std::string_view input, const url_aggregator* base_url = nullptr);
+
 /**
  * Checks whether a URL string can be successfully parsed.
  *
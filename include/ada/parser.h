@@ -23,6 +23,7 @@
 namespace ada {
 struct url_aggregator;
 struct url;
+struct parse_options;
 #if ADA_INCLUDE_URL_PATTERN
 template <url_pattern_regex::regex_concept regex_provider>
 class url_pattern;
@@ -61,16 +62,59 @@ extern template url_aggregator parse_url<url_aggregator>(
 extern template url parse_url<url>(std::string_view user_input,
                                    const url* base_url);
 
-template <typename result_type = url_aggregator, bool store_values = true>
+/**
+ * The parser behind parse_url and can_parse.
+ *
+ * @param options Optional parse options. When null, the limit of
+ *        ada::get_max_input_length() applies and no other option is set.
+ * @param recycled Optional URL whose buffer is moved into the result and
+ *        reused (only for url_aggregator). It must not be base_url.
+ * @tparam store_values When false, the parser only validates the input.
+ * @tparam plain_input When true, the input must be known to have none of the
+ *         unicode::input_features: no tab or newline, '\\', '@' or byte
+ *         that a component may percent-encode. The branches that only such
+ *         characters can reach are compiled out. The general instantiation
+ *         (false) scans the input and forwards plain inputs to it.
+ */
+template <typename result_type = url_aggregator, bool store_values = true,
+          bool plain_input = false>
 result_type parse_url_impl(std::string_view user_input,
-                           const result_type* base_url = nullptr);
+                           const result_type* base_url = nullptr,
+                           const parse_options* options = nullptr,
+                           result_type* recycled = nullptr);
 
 extern template url_aggregator parse_url_impl<url_aggregator, true>(
-    std::string_view user_input, const url_aggregator* base_url);
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
 extern template url_aggregator parse_url_impl<url_aggregator, false>(
-    std::string_view user_input, const url_aggregator* base_url);
-extern template url parse_url_impl<url, true>(std::string_view user_input,
-                                              const url* base_url);
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
+extern template url parse_url_impl<url, true>(
+    std::string_view user_input, const url* base_url,
+    const parse_options* options, url* recycled);
+extern template url_aggregator parse_url_impl<url_aggregator, true, true>(
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
+extern template url_aggregator parse_url_impl<url_aggregator, false, true>(
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
+extern template url parse_url_impl<url, true, true>(
+    std::string_view user_input, const url* base_url,
+    const parse_options* options, url* recycled);
+
+/**
+ * Builds a URL from a scheme, an authority and a path with an optional query,
+ * as delivered separately by HTTP/2 and HTTP/3 (:scheme, :authority, :path).
+ * Each part is validated and normalized the way the URL parser handles it
+ * in its own state, and the buffer is assembled once.
+ *
+ * @return The URL object. Check `is_valid` to determine if parsing
+ *         succeeded.
+ * @see ada::parse_from_parts
+ */
+url_aggregator parse_from_parts(std::string_view scheme,
+                                std::string_view authority,
+                                std::string_view path_and_query);
 
 #if ADA_INCLUDE_URL_PATTERN
 template <url_pattern_regex::regex_concept regex_provider>
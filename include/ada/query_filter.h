@@ -0,0 +1,95 @@
+/**
+ * @file query_filter.h
+ * @brief Sets of query parameter keys used to filter search strings.
+ *
+ * This file provides the `query_filter` class which stores the keys of query
+ * parameters to drop (e.g., tracking parameters such as "utm_source" or
+ * "fbclid") and is used by `url_aggregator::canonicalize_for_cache`.
+ */
+#ifndef ADA_QUERY_FILTER_H
+#define ADA_QUERY_FILTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ada/common_defs.h"
+
+namespace ada {
+
+/**
+ * @brief A set of query parameter keys with fast membership tests.
+ *
+ * A key is either matched exactly or, when it was added with a trailing '*',
+ * as a prefix: "utm_*" matches "utm_source" and "utm_medium". The keys are
+ * compared byte for byte with the key of a parameter as it appears in the
+ * serialized URL, that is, before percent-decoding.
+ *
+ * The keys are kept sorted, and a bitmap of their first bytes rejects most
+ * parameters with a single load, so that checking the keys of a query costs
+ * little more than a scan when few of them are filtered.
+ *
+ * Adding keys is not thread-safe, but a query_filter that is no longer
+ * modified may be queried from several threads.
+ *
+ * @code
+ * ada::query_filter tracking;
+ * tracking.add("utm_*");
+ * tracking.add("fbclid");
+ * auto url = ada::parse("https://example.com/?utm_source=x&b=2&a=1#top");
+ * url->canonicalize_for_cache(&tracking);
+ * url->get_href();  // "https://example.com/?a=1&b=2"
+ * @endcode
+ */
+struct query_filter {
+  query_filter() = default;
+  query_filter(const query_filter& u) = default;
+  query_filter(query_filter&& u) noexcept = default;
+  query_filter& operator=(query_filter&& u) noexcept = default;
+  query_filter& operator=(const query_filter& u) = default;
+  ~query_filter() = default;
+
+  /**
+   * Adds a key. A trailing '*' turns the rest of the key into a prefix, so
+   * that "utm_*" matches every key that starts with "utm_" and "*" matches
+   * every key.
+   */
+  void add(std::string_view key);
+
+  /**
+   * Checks whether the key matches one of the keys or prefixes of the set.
+   */
+  [[nodiscard]] bool contains(std::string_view key) const noexcept;
+
+  /**
+   * Returns the number of keys that were added.
+   */
+  [[nodiscard]] size_t size() const noexcept { return key_count; }
+
+  /**
+   * Returns true if no key was added.
+   */
+  [[nodiscard]] bool empty() const noexcept { return key_count == 0; }
+
+ private:
+  struct entry {
+    std::string key;
+    bool is_prefix;
+  };
+
+  // One bit per first byte of the entries.
+  std::array<uint64_t, 4> first_bytes{};
+  // Sorted by key so that the entries sharing a first byte are adjacent. The
+  // empty key and the empty prefix are tracked separately.
+  std::vector<entry> entries{};
+  bool has_empty_key{};
+  bool matches_everything{};
+  size_t key_count{};
+};  // query_filter
+
+}  // namespace ada
+
+#endif  // ADA_QUERY_FILTER_H
@@ -33,6 +33,22 @@ void find_longest_sequence_of_ipv6_pieces(
     const std::array<uint16_t, 8>& address, size_t& compress,
     size_t& compress_length) noexcept;
 
+/**
+ * The length of the longest serialized IPv6 address, brackets included.
+ */
+constexpr size_t ipv6_max_length = 4 * 8 + 7 + 2;
+
+/**
+ * Serializes an IPv6 address, with its brackets, into a caller-provided
+ * buffer of at least ipv6_max_length bytes.
+ *
+ * @param address The 8 16-bit pieces of the IPv6 address.
+ * @param output The destination buffer.
+ * @return The number of bytes written.
+ * @see https://url.spec.whatwg.org/#concept-ipv6-serializer
+ */
+size_t ipv6(const std::array<uint16_t, 8>& address, char* output) noexcept;
+
 /**
  * Serializes an IPv6 address to its string representation.
  *
@@ -60,11 +60,49 @@ namespace ada::unicode {
  * section 2.3.4. ICU checks for label size and domain size, but these errors
  * are ignored.
  *
+ * On success, the result overwrites 'out', whose storage may be reused. The
+ * intermediate buffers are kept per thread, so that converting hosts does not
+ * allocate in steady state.
+ *
  * @see https://url.spec.whatwg.org/#concept-domain-to-ascii
  *
  */
-bool to_ascii(std::optional<std::string>& out, std::string_view plain,
-              size_t first_percent);
+bool to_ascii(std::string& out, std::string_view plain, size_t first_percent);
+
+/**
+ * @private
+ * Same as to_ascii, but the result is written to a buffer owned by the
+ * calling thread. The view is valid until the next call to to_ascii on that
+ * thread.
+ */
+std::optional<std::string_view> to_ascii(std::string_view plain,
+                                         size_t first_percent);
+
+/**
+ * @private
+ * Bits returned by input_features.
+ */
+constexpr uint8_t input_has_tabs_or_newline = 1;
+constexpr uint8_t input_has_backslash = 2;
+constexpr uint8_t input_has_at_sign = 4;
+constexpr uint8_t input_has_percent_encoded_bytes = 8;
+
+/**
+ * @private
+ * Scans the input once and returns which of the input_has_* features it has:
+ * tab or newline characters, '\\', '@' and bytes that a component may
+ * percent-encode (controls, space, non-ASCII bytes and '"', '\'', '<', '>',
+ * '^', '`', '{', '}'). The parser uses the result to select a specialized
+ * instantiation when the input has none of them. '%', upper case letters and
+ * '[' are handled by the host, path and query code whatever the
+ * instantiation.
+ *
+ * @param percent_encoded_bytes Set to the number of bytes that a component
+ *        may percent-encode. Each of them becomes three bytes when it is, so
+ *        the parser reserves room for them up front.
+ */
+ada_really_inline uint8_t input_features(
+    std::string_view input, size_t& percent_encoded_bytes) noexcept;
 
 /**
  * @private
@@ -102,6 +140,30 @@ ada_really_inline constexpr uint8_t
 contains_forbidden_domain_code_point_or_upper(const char* input,
                                               size_t length) noexcept;
 
+/**
+ * @private
+ * Bits returned by classify_host.
+ */
+constexpr uint8_t host_forbidden = 1;
+constexpr uint8_t host_non_ascii = 2;
+constexpr uint8_t host_has_upper = 4;
+constexpr uint8_t host_has_xn_label = 8;
+constexpr uint8_t host_maybe_ipv4 = 16;
+
+/**
+ * @private
+ * Lowers the ASCII letters of the host in-place and classifies it in a single
+ * pass. The result combines host_forbidden (an ASCII forbidden domain code
+ * point, including '%'), host_non_ascii, host_has_upper (the input had an
+ * upper case ASCII letter before lowering), host_has_xn_label (a label starts
+ * with "xn--" after lowering) and host_maybe_ipv4 (the last label ends with a
+ * character that an IPv4 number can end with, see checkers::is_ipv4).
+ * When none of host_forbidden, host_non_ascii and host_has_xn_label are set,
+ * the lowered input is already the result of domain to ASCII.
+ * @see https://url.spec.whatwg.org/#forbidden-domain-code-point
+ */
+ada_really_inline uint8_t classify_host(char* input, size_t length) noexcept;
+
 /**
  * @private
  * Checks if the input is a forbidden domain code point.
@@ -197,6 +259,15 @@ ada_really_inline unsigned constexpr convert_hex_to_binary(char c) noexcept;
  */
 std::string percent_decode(std::string_view input, size_t first_percent);
 
+/**
+ * @private
+ * Percent-decodes the 'length' bytes at 'input' in place, first_percent being
+ * the index of the first '%'. Decoding never makes the content longer.
+ * Returns the decoded length.
+ */
+size_t percent_decode_in_place(char* input, size_t length,
+                               size_t first_percent) noexcept;
+
 /**
  * @private
  * Returns a percent-encoding string whether percent encoding was needed or not.
@@ -223,6 +294,14 @@ std::string percent_encode(std::string_view input,
 template <bool append>
 bool percent_encode(std::string_view input, const uint8_t character_set[],
                     std::string& out);
+/**
+ * @private
+ * Percent-encodes in place the 'length' bytes of 'out' that start at 'start'.
+ * The bytes that follow are moved once to make room, so that no temporary
+ * string is needed. Returns the number of bytes by which 'out' grew.
+ */
+size_t percent_encode_in_place(std::string& out, size_t start, size_t length,
+                               const uint8_t character_set[]);
 /**
  * @private
  * Returns the index at which percent encoding should start, or (equivalently),
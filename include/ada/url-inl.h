@@ -184,22 +184,44 @@ constexpr void url::copy_scheme(const ada::url& u) {
   type = u.type;
 }
 
+inline void url::append_protocol(std::string& output) const {
+  if (is_special()) {
+    output += ada::scheme::details::is_special_list[type];
+  } else {
+    output += non_special_scheme;
+  }
+  output += ':';
+}
+
+inline void url::append_host(std::string& output) const {
+  output += host.value();
+  if (port.has_value()) {
+    char digits[5];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), *port);
+    ADA_ASSERT_TRUE(error == std::errc());
+    output += ':';
+    output.append(digits, end);
+  }
+}
+
 [[nodiscard]] ada_really_inline std::string url::get_href() const {
-  std::string output = get_protocol();
+  // We compute the exact size first so that the serialization needs a single
+  // allocation and no temporaries.
+  std::string output;
+  output.reserve(get_href_size());
+  append_protocol(output);
 
   if (host.has_value()) {
     output += "//";
     if (has_credentials()) {
       output += username;
       if (!password.empty()) {
-        output += ":" + get_password();
+        output += ':';
+        output += password;
       }
-      output += "@";
-    }
-    output += host.value();
-    if (port.has_value()) {
-      output += ":" + get_port();
+      output += '@';
     }
+    append_host(output);
   } else if (!has_opaque_path && path.starts_with("//")) {
     // If url's host is null, url does not have an opaque path, url's path's
     // size is greater than 1, and url's path[0] is the empty string, then
@@ -208,11 +230,14 @@ constexpr void url::copy_scheme(const ada::url& u) {
   }
   output += path;
   if (query.has_value()) {
-    output += "?" + query.value();
+    output += '?';
+    output += *query;
   }
   if (hash.has_value()) {
-    output += "#" + hash.value();
+    output += '#';
+    output += *hash;
   }
+  ADA_ASSERT_EQUAL(output.size(), get_href_size(), "href size mismatch");
   return output;
 }
 
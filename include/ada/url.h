@@ -12,6 +12,7 @@
 #define ADA_URL_H
 
 #include <algorithm>
+#include <array>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -26,14 +27,17 @@
 namespace ada {
 
 struct url_aggregator;
+struct parse_options;
 
 // namespace parser {
 // template <typename result_type>
 // result_type parse_url(std::string_view user_input,
 //                       const result_type* base_url = nullptr);
-// template <typename result_type, bool store_values>
+// template <typename result_type, bool store_values, bool plain_input>
 // result_type parse_url_impl(std::string_view user_input,
-//                            const result_type* base_url = nullptr);
+//                            const result_type* base_url = nullptr,
+//                            const parse_options* options = nullptr,
+//                            result_type* recycled = nullptr);
 // }
 
 /**
@@ -67,6 +71,13 @@ struct url : url_base {
   url& operator=(const url& u) = default;
   ~url() override = default;
 
+  /**
+   * Builds a url from the components of a url_aggregator without reparsing.
+   * The aggregator is already normalized, so no validation, IDNA or
+   * percent-encoding takes place.
+   */
+  explicit url(const url_aggregator& u);
+
   // Fields are ordered so that the most frequently accessed components
   // tend to occupy earlier cache lines and remain close together in memory.
   //
@@ -199,6 +210,26 @@ struct url : url_base {
    */
   [[nodiscard]] std::string get_hostname() const;
 
+  /**
+   * Returns the URL's host as a 32-bit IPv4 address (e.g., 0x7f000001 for
+   * 127.0.0.1) when host_type is IPV4, std::nullopt otherwise.
+   * The address is not stored: each call parses the serialized hostname
+   * again, a scan of at most 15 characters.
+   * @see https://url.spec.whatwg.org/#concept-ipv4
+   */
+  [[nodiscard]] std::optional<uint32_t> get_ipv4_address() const noexcept;
+
+  /**
+   * Returns the URL's host as the eight 16-bit pieces of an IPv6 address
+   * when host_type is IPV6, std::nullopt otherwise.
+   * The address is not stored: each call parses the serialized hostname
+   * again, a scan of at most 41 characters. Keep the result when it is
+   * needed several times.
+   * @see https://url.spec.whatwg.org/#concept-ipv6
+   */
+  [[nodiscard]] std::optional<std::array<uint16_t, 8>> get_ipv6_address()
+      const noexcept;
+
   /**
    * Returns the URL's path component.
    * @return A string_view pointing to the path.
@@ -376,12 +407,28 @@ struct url : url_base {
   friend void ada::helpers::strip_trailing_spaces_from_opaque_path<ada::url>(
       ada::url& url);
 
-  friend ada::url ada::parser::parse_url_impl<ada::url, true>(std::string_view,
-                                                              const ada::url*);
-  friend ada::url_aggregator ada::parser::parse_url_impl<
-      ada::url_aggregator, true>(std::string_view, const ada::url_aggregator*);
-  friend ada::url_aggregator ada::parser::parse_url_impl<
-      ada::url_aggregator, false>(std::string_view, const ada::url_aggregator*);
+  friend ada::url ada::parser::parse_url_impl<ada::url, true>(
+      std::string_view, const ada::url*, const ada::parse_options*,
+      ada::url*);
+  friend ada::url_aggregator
+  ada::parser::parse_url_impl<ada::url_aggregator, true>(
+      std::string_view, const ada::url_aggregator*, const ada::parse_options*,
+      ada::url_aggregator*);
+  friend ada::url_aggregator
+  ada::parser::parse_url_impl<ada::url_aggregator, false>(
+      std::string_view, const ada::url_aggregator*, const ada::parse_options*,
+      ada::url_aggregator*);
+  friend ada::url ada::parser::parse_url_impl<ada::url, true, true>(
+      std::string_view, const ada::url*, const ada::parse_options*,
+      ada::url*);
+  friend ada::url_aggregator
+  ada::parser::parse_url_impl<ada::url_aggregator, true, true>(
+      std::string_view, const ada::url_aggregator*, const ada::parse_options*,
+      ada::url_aggregator*);
+  friend ada::url_aggregator
+  ada::parser::parse_url_impl<ada::url_aggregator, false, true>(
+      std::string_view, const ada::url_aggregator*, const ada::parse_options*,
+      ada::url_aggregator*);
 
   inline void update_unencoded_base_hash(std::string_view input);
   inline void update_base_hostname(std::string_view input);
@@ -393,6 +440,17 @@ struct url : url_base {
   inline void update_base_password(std::string_view input);
   inline void update_base_port(std::optional<uint16_t> input);
 
+  /**
+   * Appends the scheme followed by a colon to the output.
+   */
+  inline void append_protocol(std::string& output) const;
+
+  /**
+   * Appends the host, followed by a colon and the port if there is one, to
+   * the output. The host must not be null.
+   */
+  inline void append_host(std::string& output) const;
+
   /**
    * Sets the host or hostname according to override condition.
    * Return true on success.
@@ -448,10 +506,12 @@ struct url : url_base {
    * the input does not contain spaces or tabs. Control
    * characters and spaces are not trimmed (they should have
    * been removed if needed).
-   * Return true on success.
+   * Return true on success. The options, when given, may reject hosts that
+   * the standard accepts (see ada::parse_options).
    * @see https://url.spec.whatwg.org/#host-parsing
    */
-  [[nodiscard]] ada_really_inline bool parse_host(std::string_view input);
+  [[nodiscard]] ada_really_inline bool parse_host(
+      std::string_view input, const parse_options* options = nullptr);
 
   template <bool has_state_override = false>
   [[nodiscard]] ada_really_inline bool parse_scheme(std::string_view input);
@@ -238,22 +238,13 @@ inline void url_aggregator::update_base_search(
     }
 
     buffer.insert(components.search_start, "?");
-    size_t idx =
-        ada::unicode::percent_encode_index(input, query_percent_encode_set);
-    if (idx == input.size()) {
-      buffer.insert(components.search_start + 1, input);
-      components.hash_start += uint32_t(input.size() + 1);  // Do not forget `?`
-    } else {
-      buffer.insert(components.search_start + 1, input, 0, idx);
-      input.remove_prefix(idx);
-      // We only create a temporary string if we need percent encoding and
-      // we attempt to create as small a temporary string as we can.
-      std::string encoded =
-          ada::unicode::percent_encode(input, query_percent_encode_set);
-      buffer.insert(components.search_start + idx + 1, encoded);
-      components.hash_start +=
-          uint32_t(encoded.size() + idx + 1);  // Do not forget `?`
-    }
+    buffer.insert(components.search_start + 1, input);
+    // The input is encoded where it lands, without a temporary string.
+    components.hash_start += uint32_t(
+        input.size() + 1 +  // Do not forget `?`
+        ada::unicode::percent_encode_in_place(
+            buffer, components.search_start + 1, input.size(),
+            query_percent_encode_set));
   }
 
   ADA_ASSERT_TRUE(validate());
@@ -298,6 +289,21 @@ inline void url_aggregator::update_base_pathname(const std::string_view input) {
   ADA_ASSERT_TRUE(validate());
 }
 
+inline void url_aggregator::update_base_pathname(
+    const std::string_view input, const uint8_t* character_set) {
+  update_base_pathname(input);
+  // Percent-encode the new pathname where it lands in the buffer.
+  uint32_t difference = uint32_t(unicode::percent_encode_in_place(
+      buffer, components.pathname_start, input.size(), character_set));
+  if (components.search_start != url_components::omitted) {
+    components.search_start += difference;
+  }
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start += difference;
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
 inline void url_aggregator::append_base_pathname(const std::string_view input) {
   ada_log("url_aggregator::append_base_pathname ", input, " ", to_string(),
           "\n", to_diagram());
@@ -331,6 +337,29 @@ inline void url_aggregator::append_base_pathname(const std::string_view input) {
   ADA_ASSERT_TRUE(validate());
 }
 
+inline void url_aggregator::shorten_base_pathname(uint32_t length) {
+  ada_log("url_aggregator::shorten_base_pathname ", length);
+  ADA_ASSERT_TRUE(validate());
+  ADA_ASSERT_TRUE(length <= get_pathname_length());
+  const bool had_dash_dot = has_dash_dot();
+  // Erasing the end of the pathname in place saves a copy of what is kept.
+  uint32_t difference = get_pathname_length() - length;
+  buffer.erase(components.pathname_start + length, difference);
+  if (had_dash_dot && !get_pathname().starts_with("//")) {
+    // We must delete the ./
+    buffer.erase(components.host_end, 2);
+    components.pathname_start -= 2;
+    difference += 2;
+  }
+  if (components.search_start != url_components::omitted) {
+    components.search_start -= difference;
+  }
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start -= difference;
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
 inline void url_aggregator::update_base_username(const std::string_view input) {
   ada_log("url_aggregator::update_base_username '", input, "' ", to_string(),
           "\n", to_diagram());
@@ -413,6 +442,29 @@ inline void url_aggregator::append_base_username(const std::string_view input) {
   ADA_ASSERT_TRUE(validate());
 }
 
+inline void url_aggregator::append_base_username(
+    const std::string_view input, const uint8_t* character_set) {
+  append_base_username(input);
+  if (input.empty()) {
+    return;
+  }
+  // Percent-encode the appended bytes where they land in the buffer.
+  uint32_t difference = uint32_t(unicode::percent_encode_in_place(
+      buffer, components.username_end - input.size(), input.size(),
+      character_set));
+  components.username_end += difference;
+  components.host_start += difference;
+  components.host_end += difference;
+  components.pathname_start += difference;
+  if (components.search_start != url_components::omitted) {
+    components.search_start += difference;
+  }
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start += difference;
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
 constexpr void url_aggregator::clear_password() {
   ada_log("url_aggregator::clear_password ", to_string());
   ADA_ASSERT_TRUE(validate());
@@ -539,6 +591,29 @@ inline void url_aggregator::append_base_password(const std::string_view input) {
   ADA_ASSERT_TRUE(validate());
 }
 
+inline void url_aggregator::append_base_password(
+    const std::string_view input, const uint8_t* character_set) {
+  append_base_password(input);
+  if (input.empty()) {
+    return;
+  }
+  // Percent-encode the appended bytes where they land in the buffer, just
+  // before the '@' that follows the password.
+  uint32_t difference = uint32_t(unicode::percent_encode_in_place(
+      buffer, components.host_start - input.size(), input.size(),
+      character_set));
+  components.host_start += difference;
+  components.host_end += difference;
+  components.pathname_start += difference;
+  if (components.search_start != url_components::omitted) {
+    components.search_start += difference;
+  }
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start += difference;
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
 inline void url_aggregator::update_base_port(uint32_t input) {
   ada_log("url_aggregator::update_base_port");
   ADA_ASSERT_TRUE(validate());
@@ -635,6 +710,48 @@ inline void url_aggregator::clear_hash() {
   ADA_ASSERT_TRUE(validate());
 }
 
+inline void url_aggregator::clear_credentials() {
+  ada_log("url_aggregator::clear_credentials");
+  ADA_ASSERT_TRUE(validate());
+  // A URL without an authority may still have an '@' at host_start, as in
+  // "mailto:@foo", so only the credentials themselves are a reliable signal.
+  if (!has_credentials()) {
+    return;
+  }
+  // When there are credentials, host_start points at the '@'.
+  const uint32_t start = components.protocol_end + 2;
+  const uint32_t length = components.host_start + 1 - start;
+  buffer.erase(start, length);
+  components.username_end = start;
+  components.host_start = start;
+  components.host_end -= length;
+  components.pathname_start -= length;
+  if (components.search_start != url_components::omitted) {
+    components.search_start -= length;
+  }
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start -= length;
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
+inline bool url_aggregator::truncate_to_origin() {
+  ada_log("url_aggregator::truncate_to_origin");
+  ADA_ASSERT_TRUE(validate());
+  if (!has_authority()) {
+    return false;
+  }
+  clear_credentials();
+  buffer.resize(components.pathname_start);
+  components.search_start = url_components::omitted;
+  components.hash_start = url_components::omitted;
+  if (is_special()) {
+    buffer += '/';
+  }
+  ADA_ASSERT_TRUE(validate());
+  return true;
+}
+
 constexpr void url_aggregator::clear_pathname() {
   ada_log("url_aggregator::clear_pathname");
   ADA_ASSERT_TRUE(validate());
@@ -11,6 +11,8 @@
 #ifndef ADA_URL_AGGREGATOR_H
 #define ADA_URL_AGGREGATOR_H
 
+#include <array>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <string_view>
@@ -24,6 +26,10 @@ namespace ada {
 
 namespace parser {}
 
+struct url;
+struct query_filter;
+struct parse_options;
+
 /**
  * @brief Memory-efficient URL representation using a single buffer.
  *
@@ -51,6 +57,13 @@ struct url_aggregator : url_base {
   url_aggregator& operator=(const url_aggregator& u) = default;
   ~url_aggregator() override = default;
 
+  /**
+   * Builds a url_aggregator from the components of a url without reparsing.
+   * The url is already normalized, so the buffer is its href and only the
+   * offsets need to be computed.
+   */
+  explicit url_aggregator(const url& u);
+
   /**
    * The setter functions follow the steps defined in the URL Standard.
    *
@@ -81,6 +94,22 @@ struct url_aggregator : url_base {
   void set_search(std::string_view input);
   void set_hash(std::string_view input);
 
+  /**
+   * Rewrites the URL in place into a canonical form suitable as a cache key:
+   * - the fragment is removed,
+   * - the query parameters whose key is in the filter are removed, as are
+   *   empty parameters ("a=1&&b=2"),
+   * - the remaining parameters are sorted by key, keeping the relative order
+   *   of parameters with the same key,
+   * - a query left empty is removed together with its "?",
+   * - the hex digits of percent-escapes in the path and query are
+   *   uppercased ("%2f" becomes "%2F").
+   * The keys are compared as they appear in the URL, without decoding.
+   * The query is rewritten in a single pass over the buffer.
+   * @param filter The keys to drop, or nullptr to keep every parameter.
+   */
+  void canonicalize_for_cache(const query_filter* filter = nullptr);
+
   /**
    * Validates whether the hostname is a valid domain according to RFC 1034.
    * @return `true` if the domain is valid, `false` otherwise.
@@ -164,6 +193,26 @@ struct url_aggregator : url_base {
    */
   [[nodiscard]] std::string_view get_hostname() const ada_lifetime_bound;
 
+  /**
+   * Returns the URL's host as a 32-bit IPv4 address (e.g., 0x7f000001 for
+   * 127.0.0.1) when host_type is IPV4, std::nullopt otherwise.
+   * The address is not stored: each call parses the serialized hostname
+   * again, a scan of at most 15 characters. Does not allocate memory.
+   * @see https://url.spec.whatwg.org/#concept-ipv4
+   */
+  [[nodiscard]] std::optional<uint32_t> get_ipv4_address() const noexcept;
+
+  /**
+   * Returns the URL's host as the eight 16-bit pieces of an IPv6 address
+   * when host_type is IPV6, std::nullopt otherwise.
+   * The address is not stored: each call parses the serialized hostname
+   * again, a scan of at most 41 characters. Keep the result when it is
+   * needed several times. Does not allocate memory.
+   * @see https://url.spec.whatwg.org/#concept-ipv6
+   */
+  [[nodiscard]] std::optional<std::array<uint16_t, 8>> get_ipv6_address()
+      const noexcept;
+
   /**
    * Returns the URL's path component.
    * Does not allocate memory. The returned view becomes invalid if this
@@ -310,6 +359,29 @@ struct url_aggregator : url_base {
    */
   inline void clear_search() override;
 
+  /**
+   * Removes the username and the password from the URL.
+   */
+  inline void clear_credentials();
+
+  /**
+   * Reduces the URL to its scheme, host and port, as a referrer stripped to
+   * its origin: the credentials, path, query and fragment are removed, and
+   * special URLs keep a "/" path ("https://example.com/").
+   * @return `false`, leaving the URL unchanged, if the URL has no host.
+   */
+  inline bool truncate_to_origin();
+
+  /**
+   * Replaces the values of the query parameters whose key is in the filter
+   * with the mask: "?token=abc&a=1" becomes "?token=***&a=1". Parameters
+   * without a value are kept as they are. The mask is inserted verbatim, so
+   * it must not need percent-encoding in a query and must not contain '&'
+   * or '#'.
+   */
+  void mask_search_values(const query_filter& keys,
+                          std::string_view mask = "***");
+
  private:
   // helper methods
   friend void helpers::strip_trailing_spaces_from_opaque_path<url_aggregator>(
@@ -319,9 +391,20 @@ struct url_aggregator : url_base {
       std::string_view, const url_aggregator*);
 
   friend url_aggregator parser::parse_url_impl<url_aggregator, true>(
-      std::string_view, const url_aggregator*);
+      std::string_view, const url_aggregator*, const parse_options*,
+      url_aggregator*);
   friend url_aggregator parser::parse_url_impl<url_aggregator, false>(
-      std::string_view, const url_aggregator*);
+      std::string_view, const url_aggregator*, const parse_options*,
+      url_aggregator*);
+  friend url_aggregator parser::parse_url_impl<url_aggregator, true, true>(
+      std::string_view, const url_aggregator*, const parse_options*,
+      url_aggregator*);
+  friend url_aggregator parser::parse_url_impl<url_aggregator, false, true>(
+      std::string_view, const url_aggregator*, const parse_options*,
+      url_aggregator*);
+  friend url_aggregator parser::parse_from_parts(std::string_view,
+                                                 std::string_view,
+                                                 std::string_view);
 
 #if ADA_INCLUDE_URL_PATTERN
   // url_pattern methods
@@ -391,7 +474,8 @@ struct url_aggregator : url_base {
   template <bool override_hostname = false>
   bool set_host_or_hostname(std::string_view input);
 
-  ada_really_inline bool parse_host(std::string_view input);
+  ada_really_inline bool parse_host(std::string_view input,
+                                    const parse_options* options = nullptr);
 
   inline void update_base_authority(std::string_view base_buffer,
                                     const url_components& base);
@@ -401,12 +485,19 @@ struct url_aggregator : url_base {
   inline void update_base_search(std::string_view input,
                                  const uint8_t* query_percent_encode_set);
   inline void update_base_pathname(std::string_view input);
+  inline void update_base_pathname(std::string_view input,
+                                   const uint8_t* character_set);
   inline void update_base_username(std::string_view input);
   inline void append_base_username(std::string_view input);
+  inline void append_base_username(std::string_view input,
+                                   const uint8_t* character_set);
   inline void update_base_password(std::string_view input);
   inline void append_base_password(std::string_view input);
+  inline void append_base_password(std::string_view input,
+                                   const uint8_t* character_set);
   inline void update_base_port(uint32_t input);
   inline void append_base_pathname(std::string_view input);
+  inline void shorten_base_pathname(uint32_t length);
   [[nodiscard]] inline uint32_t retrieve_base_port() const;
   constexpr void clear_hostname();
   constexpr void clear_password();
@@ -44,6 +44,10 @@ ada_url ada_parse(const char* input, size_t length);
 ada_url ada_parse_with_base(const char* input, size_t input_length,
                             const char* base, size_t base_length);
 
+// parses the input into an existing result, reusing its memory when it holds
+// a valid URL, returns whether the input is valid (same as ada_is_valid)
+bool ada_parse_into(ada_url result, const char* input, size_t length);
+
 // input and base should be a null terminated C strings
 bool ada_can_parse(const char* input, size_t length);
 bool ada_can_parse_with_base(const char* input, size_t input_length,
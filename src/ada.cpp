@@ -1,6 +1,7 @@
 #include "ada.h"
 #include "checkers.cpp"
 #include "unicode.cpp"
+#include "idna_extensions.cpp"
 #include "serializers.cpp"
 #include "implementation.cpp"
 #include "helpers.cpp"
@@ -8,6 +9,8 @@
 #include "parser.cpp"
 #include "url_components.cpp"
 #include "url_aggregator.cpp"
+#include "cidr_set.cpp"
+#include "query_filter.cpp"
 
 #if ADA_INCLUDE_URL_PATTERN
 #include "url_pattern.cpp"
@@ -3,8 +3,19 @@
 #include "ada/url_aggregator-inl.h"
 #include "ada/url_search_params-inl.h"
 
+// The object behind an ada_url. When ada_parse_into fails, the storage of
+// the URL it replaces is kept in spare, so that the next call can reuse it.
+struct ada_url_instance {
+  ada::result<ada::url_aggregator> result{};
+  ada::url_aggregator spare{};
+};
+
+ada_url_instance& get_url_instance(void* result) noexcept {
+  return *(ada_url_instance*)result;
+}
+
 ada::result<ada::url_aggregator>& get_instance(void* result) noexcept {
-  return *(ada::result<ada::url_aggregator>*)result;
+  return get_url_instance(result).result;
 }
 
 extern "C" {
@@ -68,8 +79,8 @@ struct ada_url_components {
 };
 
 ada_url ada_parse(const char* input, size_t length) noexcept {
-  return new ada::result<ada::url_aggregator>(
-      ada::parse<ada::url_aggregator>(std::string_view(input, length)));
+  return new ada_url_instance{
+      ada::parse<ada::url_aggregator>(std::string_view(input, length))};
 }
 
 ada_url ada_parse_with_base(const char* input, size_t input_length,
@@ -78,11 +89,32 @@ ada_url ada_parse_with_base(const char* input, size_t input_length,
       ada::parse<ada::url_aggregator>(std::string_view(base, base_length));
 
   if (!base_out) {
-    return new ada::result<ada::url_aggregator>(base_out);
+    return new ada_url_instance{base_out};
   }
 
-  return new ada::result<ada::url_aggregator>(ada::parse<ada::url_aggregator>(
-      std::string_view(input, input_length), &base_out.value()));
+  return new ada_url_instance{ada::parse<ada::url_aggregator>(
+      std::string_view(input, input_length), &base_out.value())};
+}
+
+bool ada_parse_into(ada_url result, const char* input,
+                    size_t length) noexcept {
+  ada_url_instance& instance = get_url_instance(result);
+  ada::result<ada::url_aggregator>& r = instance.result;
+  std::string_view input_view(input, length);
+  if (!r) {
+    // Parse into the storage kept from the last valid URL, if any.
+    if (!ada::parse_into(instance.spare, input_view)) {
+      return false;
+    }
+    r = std::move(instance.spare);
+    return true;
+  }
+  if (!ada::parse_into(*r, input_view)) {
+    instance.spare = std::move(*r);
+    r = tl::unexpected(ada::errors::type_error);
+    return false;
+  }
+  return true;
 }
 
 bool ada_can_parse(const char* input, size_t length) noexcept {
@@ -96,13 +128,13 @@ bool ada_can_parse_with_base(const char* input, size_t input_length,
 }
 
 void ada_free(ada_url result) noexcept {
-  auto* r = (ada::result<ada::url_aggregator>*)result;
+  auto* r = (ada_url_instance*)result;
   delete r;
 }
 
 ada_url ada_copy(ada_url input) noexcept {
   ada::result<ada::url_aggregator>& r = get_instance(input);
-  return new ada::result<ada::url_aggregator>(r);
+  return new ada_url_instance{r};
 }
 
 bool ada_is_valid(ada_url result) noexcept {
@@ -5,7 +5,15 @@
 
 #include <algorithm>
 #include <array>
+#include <optional>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#if ADA_NEON
+#include <arm_neon.h>
+#elif ADA_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace ada::checkers {
 
@@ -83,6 +91,111 @@ static constexpr std::array<uint8_t, 256> path_signature_table =
       return result;
     }();
 
+constexpr uint8_t path_signature_dot_segment = 16;
+
+constexpr bool is_path_separator(char c) noexcept {
+  return c == '/' || c == '\\';
+}
+
+#if ADA_NEON
+ada_really_inline uint8_t path_signature_simd(std::string_view input) noexcept {
+  // We classify 16 bytes at a time. A segment starts with a dot when the
+  // previous byte is '/' or '\\', or when the dot is the first byte of the
+  // input: we shift the separator mask by one byte to find these dots.
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+  uint8x16_t need_encoding = vdupq_n_u8(0);
+  uint8x16_t backslash = vdupq_n_u8(0);
+  uint8x16_t dot = vdupq_n_u8(0);
+  uint8x16_t percent = vdupq_n_u8(0);
+  uint8x16_t dot_segment = vdupq_n_u8(0);
+  uint8x16_t previous_separator = vdupq_n_u8(0xFF);
+  size_t i = 0;
+  for (; i + 15 < input.size(); i += 16) {
+    uint8x16_t word = vld1q_u8(data + i);
+    uint8x16_t encode = vorrq_u8(vcleq_u8(word, vdupq_n_u8(0x20)),
+                                 vcgeq_u8(word, vdupq_n_u8(0x7f)));
+    for (uint8_t c : {'"', '#', '<', '>', '?', '^', '`', '{', '}'}) {
+      encode = vorrq_u8(encode, vceqq_u8(word, vdupq_n_u8(c)));
+    }
+    uint8x16_t is_backslash = vceqq_u8(word, vdupq_n_u8('\\'));
+    uint8x16_t is_dot = vceqq_u8(word, vdupq_n_u8('.'));
+    uint8x16_t separator =
+        vorrq_u8(is_backslash, vceqq_u8(word, vdupq_n_u8('/')));
+    need_encoding = vorrq_u8(need_encoding, encode);
+    backslash = vorrq_u8(backslash, is_backslash);
+    dot = vorrq_u8(dot, is_dot);
+    percent = vorrq_u8(percent, vceqq_u8(word, vdupq_n_u8('%')));
+    dot_segment = vorrq_u8(
+        dot_segment,
+        vandq_u8(is_dot, vextq_u8(previous_separator, separator, 15)));
+    previous_separator = separator;
+  }
+  uint8_t accumulator = uint8_t(
+      (vmaxvq_u8(need_encoding) ? 1 : 0) | (vmaxvq_u8(backslash) ? 2 : 0) |
+      (vmaxvq_u8(dot) ? 4 : 0) | (vmaxvq_u8(percent) ? 8 : 0) |
+      (vmaxvq_u8(dot_segment) ? path_signature_dot_segment : 0));
+  for (; i < input.size(); i++) {
+    accumulator |= uint8_t(path_signature_table[data[i]]);
+    if (input[i] == '.' && is_path_separator(input[i - 1])) {
+      accumulator |= path_signature_dot_segment;
+    }
+  }
+  return accumulator;
+}
+#elif ADA_SSE2
+ada_really_inline uint8_t path_signature_simd(std::string_view input) noexcept {
+  // We classify 16 bytes at a time. A segment starts with a dot when the
+  // previous byte is '/' or '\\', or when the dot is the first byte of the
+  // input: we shift the separator mask by one byte to find these dots.
+  const __m128i c20 = _mm_set1_epi8(0x20);
+  const __m128i c7f = _mm_set1_epi8(0x7f);
+  __m128i need_encoding = _mm_setzero_si128();
+  __m128i backslash = _mm_setzero_si128();
+  __m128i dot = _mm_setzero_si128();
+  __m128i percent = _mm_setzero_si128();
+  __m128i dot_segment = _mm_setzero_si128();
+  // Only the last byte matters: the input starts a segment.
+  __m128i previous_separator = _mm_slli_si128(_mm_set1_epi8(-1), 15);
+  size_t i = 0;
+  for (; i + 15 < input.size(); i += 16) {
+    __m128i word = _mm_loadu_si128((const __m128i*)(input.data() + i));
+    // Unsigned comparisons: word <= 0x20 or word >= 0x7f.
+    __m128i encode =
+        _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(word, c20), word),
+                     _mm_cmpeq_epi8(_mm_max_epu8(word, c7f), word));
+    for (char c : {'"', '#', '<', '>', '?', '^', '`', '{', '}'}) {
+      encode = _mm_or_si128(encode, _mm_cmpeq_epi8(word, _mm_set1_epi8(c)));
+    }
+    __m128i is_backslash = _mm_cmpeq_epi8(word, _mm_set1_epi8('\\'));
+    __m128i is_dot = _mm_cmpeq_epi8(word, _mm_set1_epi8('.'));
+    __m128i separator =
+        _mm_or_si128(is_backslash, _mm_cmpeq_epi8(word, _mm_set1_epi8('/')));
+    need_encoding = _mm_or_si128(need_encoding, encode);
+    backslash = _mm_or_si128(backslash, is_backslash);
+    dot = _mm_or_si128(dot, is_dot);
+    percent =
+        _mm_or_si128(percent, _mm_cmpeq_epi8(word, _mm_set1_epi8('%')));
+    __m128i separator_before = _mm_or_si128(
+        _mm_slli_si128(separator, 1), _mm_srli_si128(previous_separator, 15));
+    dot_segment =
+        _mm_or_si128(dot_segment, _mm_and_si128(is_dot, separator_before));
+    previous_separator = separator;
+  }
+  uint8_t accumulator = uint8_t(
+      (_mm_movemask_epi8(need_encoding) ? 1 : 0) |
+      (_mm_movemask_epi8(backslash) ? 2 : 0) |
+      (_mm_movemask_epi8(dot) ? 4 : 0) | (_mm_movemask_epi8(percent) ? 8 : 0) |
+      (_mm_movemask_epi8(dot_segment) ? path_signature_dot_segment : 0));
+  for (; i < input.size(); i++) {
+    accumulator |= uint8_t(path_signature_table[uint8_t(input[i])]);
+    if (input[i] == '.' && is_path_separator(input[i - 1])) {
+      accumulator |= path_signature_dot_segment;
+    }
+  }
+  return accumulator;
+}
+#endif
+
 ada_really_inline constexpr uint8_t path_signature(
     std::string_view input) noexcept {
   // The path percent-encode set is the query percent-encode set and U+003F (?),
@@ -90,6 +203,11 @@ ada_really_inline constexpr uint8_t path_signature(
   // C0 control percent-encode set and U+0020 SPACE, U+0022 ("), U+0023 (#),
   // U+003C (<), and U+003E (>). The C0 control percent-encode set are the C0
   // controls and all code points greater than U+007E (~).
+#if ADA_NEON || ADA_SSE2
+  if (!std::is_constant_evaluated() && input.size() >= 16) {
+    return path_signature_simd(input);
+  }
+#endif
   size_t i = 0;
   uint8_t accumulator{};
   for (; i + 7 < input.size(); i += 8) {
@@ -105,6 +223,17 @@ ada_really_inline constexpr uint8_t path_signature(
   for (; i < input.size(); i++) {
     accumulator |= uint8_t(path_signature_table[uint8_t(input[i])]);
   }
+  if (accumulator & 4) {
+    // Short input: look for a dot at the start of a segment.
+    bool previous_is_separator = true;
+    for (char c : input) {
+      if (c == '.' && previous_is_separator) {
+        accumulator |= path_signature_dot_segment;
+        break;
+      }
+      previous_is_separator = is_path_separator(c);
+    }
+  }
   return accumulator;
 }
 
@@ -131,4 +260,210 @@ ada_really_inline constexpr bool verify_dns_length(
   return true;
 }
 
+bool parse_ipv6(std::string_view input,
+                std::array<uint16_t, 8>& address) noexcept {
+  if (input.empty()) {
+    return false;
+  }
+  // Let address be a new IPv6 address whose IPv6 pieces are all 0.
+  address = {};
+
+  // Let pieceIndex be 0.
+  int piece_index = 0;
+
+  // Let compress be null.
+  std::optional<int> compress{};
+
+  // Let pointer be a pointer for input.
+  std::string_view::iterator pointer = input.begin();
+
+  // If c is U+003A (:), then:
+  if (input[0] == ':') {
+    // If remaining does not start with U+003A (:), validation error, return
+    // failure.
+    if (input.size() == 1 || input[1] != ':') {
+      return false;
+    }
+
+    // Increase pointer by 2.
+    pointer += 2;
+
+    // Increase pieceIndex by 1 and then set compress to pieceIndex.
+    compress = ++piece_index;
+  }
+
+  // While c is not the EOF code point:
+  while (pointer != input.end()) {
+    // If pieceIndex is 8, validation error, return failure.
+    if (piece_index == 8) {
+      return false;
+    }
+
+    // If c is U+003A (:), then:
+    if (*pointer == ':') {
+      // If compress is non-null, validation error, return failure.
+      if (compress.has_value()) {
+        return false;
+      }
+
+      // Increase pointer and pieceIndex by 1, set compress to pieceIndex, and
+      // then continue.
+      pointer++;
+      compress = ++piece_index;
+      continue;
+    }
+
+    // Let value and length be 0.
+    uint16_t value = 0, length = 0;
+
+    // While length is less than 4 and c is an ASCII hex digit,
+    // set value to value times 0x10 + c interpreted as hexadecimal number, and
+    // increase pointer and length by 1.
+    while (length < 4 && pointer != input.end() &&
+           unicode::is_ascii_hex_digit(*pointer)) {
+      // https://stackoverflow.com/questions/39060852/why-does-the-addition-of-two-shorts-return-an-int
+      value = uint16_t(value * 0x10 + unicode::convert_hex_to_binary(*pointer));
+      pointer++;
+      length++;
+    }
+
+    // If c is U+002E (.), then:
+    if (pointer != input.end() && *pointer == '.') {
+      // If length is 0, validation error, return failure.
+      if (length == 0) {
+        return false;
+      }
+
+      // Decrease pointer by length.
+      pointer -= length;
+
+      // If pieceIndex is greater than 6, validation error, return failure.
+      if (piece_index > 6) {
+        return false;
+      }
+
+      // Let numbersSeen be 0.
+      int numbers_seen = 0;
+
+      // While c is not the EOF code point:
+      while (pointer != input.end()) {
+        // Let ipv4Piece be null.
+        std::optional<uint16_t> ipv4_piece{};
+
+        // If numbersSeen is greater than 0, then:
+        if (numbers_seen > 0) {
+          // If c is a U+002E (.) and numbersSeen is less than 4, then increase
+          // pointer by 1.
+          if (*pointer == '.' && numbers_seen < 4) {
+            pointer++;
+          }
+          // Otherwise, validation error, return failure.
+          else {
+            return false;
+          }
+        }
+
+        // If c is not an ASCII digit, validation error, return failure.
+        if (pointer == input.end() || !is_digit(*pointer)) {
+          return false;
+        }
+
+        // While c is an ASCII digit:
+        while (pointer != input.end() && is_digit(*pointer)) {
+          // Let number be c interpreted as decimal number.
+          int number = *pointer - '0';
+
+          // If ipv4Piece is null, then set ipv4Piece to number.
+          if (!ipv4_piece.has_value()) {
+            ipv4_piece = number;
+          }
+          // Otherwise, if ipv4Piece is 0, validation error, return failure.
+          else if (ipv4_piece == 0) {
+            return false;
+          }
+          // Otherwise, set ipv4Piece to ipv4Piece times 10 + number.
+          else {
+            ipv4_piece = *ipv4_piece * 10 + number;
+          }
+
+          // If ipv4Piece is greater than 255, validation error, return failure.
+          if (ipv4_piece > 255) {
+            return false;
+          }
+
+          // Increase pointer by 1.
+          pointer++;
+        }
+
+        // Set address[pieceIndex] to address[pieceIndex] times 0x100 +
+        // ipv4Piece.
+        // https://stackoverflow.com/questions/39060852/why-does-the-addition-of-two-shorts-return-an-int
+        address[piece_index] =
+            uint16_t(address[piece_index] * 0x100 + *ipv4_piece);
+
+        // Increase numbersSeen by 1.
+        numbers_seen++;
+
+        // If numbersSeen is 2 or 4, then increase pieceIndex by 1.
+        if (numbers_seen == 2 || numbers_seen == 4) {
+          piece_index++;
+        }
+      }
+
+      // If numbersSeen is not 4, validation error, return failure.
+      if (numbers_seen != 4) {
+        return false;
+      }
+
+      // Break.
+      break;
+    }
+    // Otherwise, if c is U+003A (:):
+    else if ((pointer != input.end()) && (*pointer == ':')) {
+      // Increase pointer by 1.
+      pointer++;
+
+      // If c is the EOF code point, validation error, return failure.
+      if (pointer == input.end()) {
+        return false;
+      }
+    }
+    // Otherwise, if c is not the EOF code point, validation error, return
+    // failure.
+    else if (pointer != input.end()) {
+      return false;
+    }
+
+    // Set address[pieceIndex] to value.
+    address[piece_index] = value;
+
+    // Increase pieceIndex by 1.
+    piece_index++;
+  }
+
+  // If compress is non-null, then:
+  if (compress.has_value()) {
+    // Let swaps be pieceIndex - compress.
+    int swaps = piece_index - *compress;
+
+    // Set pieceIndex to 7.
+    piece_index = 7;
+
+    // While pieceIndex is not 0 and swaps is greater than 0,
+    // swap address[pieceIndex] with address[compress + swaps - 1], and then
+    // decrease both pieceIndex and swaps by 1.
+    while (piece_index != 0 && swaps > 0) {
+      std::swap(address[piece_index], address[*compress + swaps - 1]);
+      piece_index--;
+      swaps--;
+    }
+  }
+  // Otherwise, if compress is null and pieceIndex is not 8, validation error,
+  // return failure.
+  else if (piece_index != 8) {
+    return false;
+  }
+  return true;
+}
+
 }  // namespace ada::checkers
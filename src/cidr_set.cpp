@@ -0,0 +1,212 @@
+#include "ada/cidr_set.h"
+#include "ada/checkers-inl.h"
+#include "ada/implementation.h"
+
+#include <bit>
+#include <charconv>
+
+namespace ada {
+
+namespace {
+
+constexpr size_t cidr_stride = 6;
+
+// Returns the 6 bits of the 128-bit key (high, low) starting at bit offset
+// 'offset' (counting from the most significant bit). Bits past the end of the
+// key read as zero.
+ada_really_inline constexpr uint64_t cidr_chunk(uint64_t high, uint64_t low,
+                                                size_t offset) noexcept {
+  uint64_t window;
+  if (offset == 0) {
+    window = high;
+  } else if (offset < 64) {
+    window = (high << offset) | (low >> (64 - offset));
+  } else {
+    window = low << (offset - 64);
+  }
+  return window >> (64 - cidr_stride);
+}
+
+constexpr uint64_t ipv6_high(const std::array<uint16_t, 8>& ipv6) noexcept {
+  return (uint64_t(ipv6[0]) << 48) | (uint64_t(ipv6[1]) << 32) |
+         (uint64_t(ipv6[2]) << 16) | uint64_t(ipv6[3]);
+}
+
+constexpr uint64_t ipv6_low(const std::array<uint16_t, 8>& ipv6) noexcept {
+  return (uint64_t(ipv6[4]) << 48) | (uint64_t(ipv6[5]) << 32) |
+         (uint64_t(ipv6[6]) << 16) | uint64_t(ipv6[7]);
+}
+
+}  // namespace
+
+uint32_t cidr_set::trie::add_child(uint32_t index, uint64_t bit) {
+  // The children of a node must stay contiguous, so we move them to the end
+  // of the vector together with the new child. The old block becomes garbage.
+  const node parent = nodes[index];
+  const uint32_t count = uint32_t(std::popcount(parent.children));
+  const uint32_t position = uint32_t(std::popcount(parent.children & (bit - 1)));
+  const uint32_t new_base = uint32_t(nodes.size());
+  nodes.resize(nodes.size() + count + 1);
+  for (uint32_t i = 0; i < position; i++) {
+    nodes[new_base + i] = nodes[parent.base + i];
+  }
+  for (uint32_t i = position; i < count; i++) {
+    nodes[new_base + i + 1] = nodes[parent.base + i];
+  }
+  nodes[index].children |= bit;
+  nodes[index].base = new_base;
+  garbage += count;
+  return new_base + position;
+}
+
+void cidr_set::trie::compact() {
+  // Breadth-first copy of the reachable nodes. Children hidden behind a leaf
+  // slot can never be visited and are dropped.
+  std::vector<node> result;
+  result.reserve(nodes.size() - garbage);
+  result.push_back(nodes[0]);
+  for (size_t i = 0; i < result.size(); i++) {
+    const node current = result[i];
+    const uint64_t keep = current.children & ~current.leaf;
+    result[i].children = keep;
+    result[i].base = uint32_t(result.size());
+    uint64_t remaining = current.children;
+    for (uint32_t j = 0; remaining != 0; j++) {
+      const uint64_t bit = remaining & (~remaining + 1);
+      remaining ^= bit;
+      if (keep & bit) {
+        result.push_back(nodes[current.base + j]);
+      }
+    }
+  }
+  nodes = std::move(result);
+  garbage = 0;
+}
+
+void cidr_set::trie::insert(uint64_t high, uint64_t low, size_t length) {
+  uint32_t index = 0;
+  size_t offset = 0;
+  while (length - offset > cidr_stride) {
+    const uint64_t bit = uint64_t(1) << cidr_chunk(high, low, offset);
+    const node& current = nodes[index];
+    if (current.leaf & bit) {
+      // A shorter prefix already covers this one.
+      return;
+    }
+    if (current.children & bit) {
+      index = current.base +
+              uint32_t(std::popcount(current.children & (bit - 1)));
+    } else {
+      index = add_child(index, bit);
+    }
+    offset += cidr_stride;
+  }
+  // The last (partial) chunk covers 2^(6 - remaining) consecutive slots.
+  const size_t free_bits = cidr_stride - (length - offset);
+  const uint64_t first = cidr_chunk(high, low, offset) >> free_bits
+                                                         << free_bits;
+  const uint64_t span = uint64_t(1) << free_bits;
+  const uint64_t mask =
+      (span == 64) ? ~uint64_t(0) : ((uint64_t(1) << span) - 1) << first;
+  nodes[index].leaf |= mask;
+  if (garbage > nodes.size() / 2) {
+    compact();
+  }
+}
+
+bool cidr_set::trie::lookup(uint64_t high, uint64_t low) const noexcept {
+  uint32_t index = 0;
+  for (size_t offset = 0;; offset += cidr_stride) {
+    const node& current = nodes[index];
+    const uint64_t bit = uint64_t(1) << cidr_chunk(high, low, offset);
+    if (current.leaf & bit) {
+      return true;
+    }
+    if ((current.children & bit) == 0) {
+      return false;
+    }
+    index =
+        current.base + uint32_t(std::popcount(current.children & (bit - 1)));
+  }
+}
+
+bool cidr_set::add(uint32_t ipv4, uint8_t prefix_length) {
+  if (prefix_length > 32) {
+    return false;
+  }
+  ipv4_trie.insert(uint64_t(ipv4) << 32, 0, prefix_length);
+  prefix_count++;
+  return true;
+}
+
+bool cidr_set::add(const std::array<uint16_t, 8>& ipv6,
+                   uint8_t prefix_length) {
+  if (prefix_length > 128) {
+    return false;
+  }
+  ipv6_trie.insert(ipv6_high(ipv6), ipv6_low(ipv6), prefix_length);
+  prefix_count++;
+  return true;
+}
+
+bool cidr_set::add(std::string_view cidr) {
+  std::string_view address = cidr;
+  std::string_view length_view{};
+  const size_t slash = cidr.find('/');
+  if (slash != std::string_view::npos) {
+    address = cidr.substr(0, slash);
+    length_view = cidr.substr(slash + 1);
+    if (length_view.empty()) {
+      return false;
+    }
+  }
+  if (address.empty()) {
+    return false;
+  }
+  const bool is_ipv6 = address.find(':') != std::string_view::npos;
+  uint32_t length = is_ipv6 ? 128 : 32;
+  if (!length_view.empty()) {
+    auto r = std::from_chars(length_view.data(),
+                             length_view.data() + length_view.size(), length);
+    if (r.ec != std::errc() || r.ptr != length_view.data() + length_view.size()) {
+      return false;
+    }
+  }
+  if (is_ipv6) {
+    if (address.front() == '[') {
+      address.remove_prefix(1);
+      if (address.empty() || address.back() != ']') {
+        return false;
+      }
+      address.remove_suffix(1);
+    }
+    std::array<uint16_t, 8> ipv6{};
+    return length <= 128 && checkers::parse_ipv6(address, ipv6) &&
+           add(ipv6, uint8_t(length));
+  }
+  // Only the canonical dotted-decimal form is accepted: "10/8" is not
+  // 10.0.0.0/8 but would be read as 0.0.0.10 by the URL parser.
+  const uint64_t ipv4 = checkers::try_parse_ipv4_fast(address);
+  if ((ipv4 & (checkers::ipv4_fast_fail | checkers::ipv4_fast_reserialize)) ||
+      address.back() == '.' || length > 32) {
+    return false;
+  }
+  return add(uint32_t(ipv4 & 0xFFFFFFFF), uint8_t(length));
+}
+
+bool cidr_set::contains(uint32_t ipv4) const noexcept {
+  return ipv4_trie.lookup(uint64_t(ipv4) << 32, 0);
+}
+
+bool cidr_set::contains(const std::array<uint16_t, 8>& ipv6) const noexcept {
+  // IPv4-mapped addresses (::ffff:a.b.c.d) are checked against the IPv4
+  // prefixes as well.
+  if (ipv6[0] == 0 && ipv6[1] == 0 && ipv6[2] == 0 && ipv6[3] == 0 &&
+      ipv6[4] == 0 && ipv6[5] == 0xffff &&
+      contains((uint32_t(ipv6[6]) << 16) | ipv6[7])) {
+    return true;
+  }
+  return ipv6_trie.lookup(ipv6_high(ipv6), ipv6_low(ipv6));
+}
+
+}  // namespace ada
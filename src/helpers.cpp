@@ -1,3 +1,4 @@
+#include <bit>
 #include <cstdint>
 #include <cstring>
 #include <sstream>
@@ -11,6 +12,11 @@
 #if ADA_SSSE3
 #include <tmmintrin.h>
 #endif
+#if ADA_NEON
+#include <arm_neon.h>
+#elif ADA_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace ada::helpers {
 
@@ -827,6 +833,184 @@ void trim_c0_whitespace(std::string_view& input) noexcept {
   }
 }
 
+// The positions of the path separators, of the dots and of the "%2e"
+// sequences (in any case) in 64 bytes of a path, one bit per byte. A "%2e"
+// sequence is marked at its '%', and only when it fits in the block.
+struct path_block_masks {
+  uint64_t separator;
+  uint64_t dot;
+  uint64_t percent_2e;
+};
+
+ada_really_inline path_block_masks
+classify_path_block(const char* block, bool backslash_is_separator) noexcept {
+  uint64_t separator = 0, dot = 0, percent = 0, two = 0, e = 0;
+#if ADA_NEON
+  auto to_bitmask = [](uint8x16_t input) -> uint64_t {
+    uint8x16_t bit_mask =
+        ada_make_uint8x16_t(0x01, 0x02, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x01,
+                            0x02, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80);
+    uint8x16_t minput = vandq_u8(input, bit_mask);
+    uint8x16_t tmp = vpaddq_u8(minput, minput);
+    tmp = vpaddq_u8(tmp, tmp);
+    tmp = vpaddq_u8(tmp, tmp);
+    return vgetq_lane_u16(vreinterpretq_u16_u8(tmp), 0);
+  };
+  const uint8x16_t backslash =
+      vdupq_n_u8(backslash_is_separator ? '\\' : '/');
+  for (size_t i = 0; i < 64; i += 16) {
+    uint8x16_t word = vld1q_u8(reinterpret_cast<const uint8_t*>(block + i));
+    separator |= to_bitmask(vorrq_u8(vceqq_u8(word, vdupq_n_u8('/')),
+                                     vceqq_u8(word, backslash)))
+                 << i;
+    dot |= to_bitmask(vceqq_u8(word, vdupq_n_u8('.'))) << i;
+    percent |= to_bitmask(vceqq_u8(word, vdupq_n_u8('%'))) << i;
+    two |= to_bitmask(vceqq_u8(word, vdupq_n_u8('2'))) << i;
+    e |= to_bitmask(vceqq_u8(vorrq_u8(word, vdupq_n_u8(0x20)),
+                             vdupq_n_u8('e')))
+         << i;
+  }
+#elif ADA_SSE2
+  const __m128i backslash =
+      _mm_set1_epi8(backslash_is_separator ? '\\' : '/');
+  for (size_t i = 0; i < 64; i += 16) {
+    __m128i word = _mm_loadu_si128((const __m128i*)(block + i));
+    auto to_bitmask = [](__m128i input) -> uint64_t {
+      return uint16_t(_mm_movemask_epi8(input));
+    };
+    separator |=
+        to_bitmask(_mm_or_si128(_mm_cmpeq_epi8(word, _mm_set1_epi8('/')),
+                                _mm_cmpeq_epi8(word, backslash)))
+        << i;
+    dot |= to_bitmask(_mm_cmpeq_epi8(word, _mm_set1_epi8('.'))) << i;
+    percent |= to_bitmask(_mm_cmpeq_epi8(word, _mm_set1_epi8('%'))) << i;
+    two |= to_bitmask(_mm_cmpeq_epi8(word, _mm_set1_epi8('2'))) << i;
+    e |= to_bitmask(_mm_cmpeq_epi8(_mm_or_si128(word, _mm_set1_epi8(0x20)),
+                                   _mm_set1_epi8('e')))
+         << i;
+  }
+#else
+  for (size_t i = 0; i < 64; i++) {
+    const char c = block[i];
+    separator |=
+        uint64_t(c == '/' || (backslash_is_separator && c == '\\')) << i;
+    dot |= uint64_t(c == '.') << i;
+    percent |= uint64_t(c == '%') << i;
+    two |= uint64_t(c == '2') << i;
+    e |= uint64_t((c | 0x20) == 'e') << i;
+  }
+#endif
+  return {separator, dot, percent & (two >> 1) & (e >> 2)};
+}
+
+ada_really_inline void append_normalized_path(std::string_view input,
+                                              ada::scheme::type type,
+                                              bool needs_percent_encoding,
+                                              std::string& output,
+                                              size_t path_start) {
+  ada_log("append_normalized_path ", input);
+  const bool is_file = type == ada::scheme::type::FILE;
+  const bool backslash_is_separator = type != ada::scheme::NOT_SPECIAL;
+  // Removes the last segment of the path, unless the path is a single
+  // normalized Windows drive letter of a file URL. Only the removed segment
+  // is scanned: we never look at the same byte twice.
+  auto shorten = [&]() {
+    std::string_view path = std::string_view(output).substr(path_start);
+    size_t last_delimiter = path.rfind('/');
+    if (last_delimiter == std::string_view::npos ||
+        (is_file && last_delimiter == 0 &&
+         checkers::is_normalized_windows_drive_letter(path.substr(1)))) {
+      return;
+    }
+    output.resize(path_start + last_delimiter);
+  };
+  size_t segment_start = 0;
+  for (size_t block_start = 0;; block_start += 64) {
+    // The last block is padded with zeros, which are not separators. It ends
+    // with a separator past the input so that the last segment is handled
+    // with the others. When the input is a multiple of 64 bytes long, the
+    // last block is empty.
+    const bool last_block = input.size() - block_start < 64;
+    char padded[64];
+    const char* block = input.data() + block_start;
+    if (last_block) {
+      std::memset(padded, 0, sizeof(padded));
+      if (input.size() > block_start) {
+        std::memcpy(padded, block, input.size() - block_start);
+      }
+      block = padded;
+    }
+    const path_block_masks masks =
+        classify_path_block(block, backslash_is_separator);
+    uint64_t separators = masks.separator;
+    if (last_block) {
+      separators |= uint64_t(1) << (input.size() - block_start);
+    }
+    for (; separators != 0; separators &= separators - 1) {
+      const size_t segment_end = block_start + std::countr_zero(separators);
+      const size_t length = segment_end - segment_start;
+      const bool is_last_segment = segment_end == input.size();
+      std::string_view segment = input.substr(segment_start, length);
+      // A dot segment is at most 6 bytes long ("%2e%2e"). When it is within
+      // the block, the masks tell us what it is.
+      bool single_dot = false;
+      bool double_dot = false;
+      if (length <= 6) {
+        if (segment_start >= block_start) {
+          const size_t offset = segment_start - block_start;
+          auto dot_at = [&](size_t i) {
+            return ((masks.dot >> (offset + i)) & 1) != 0;
+          };
+          auto percent_2e_at = [&](size_t i) {
+            return ((masks.percent_2e >> (offset + i)) & 1) != 0;
+          };
+          single_dot =
+              (length == 1 && dot_at(0)) || (length == 3 && percent_2e_at(0));
+          double_dot = (length == 2 && dot_at(0) && dot_at(1)) ||
+                       (length == 4 && ((dot_at(0) && percent_2e_at(1)) ||
+                                        (percent_2e_at(0) && dot_at(3)))) ||
+                       (length == 6 && percent_2e_at(0) && percent_2e_at(3));
+        } else {
+          // The segment straddles two blocks.
+          single_dot = unicode::is_single_dot_path_segment(segment);
+          double_dot = unicode::is_double_dot_path_segment(segment);
+        }
+      }
+      if (double_dot) {
+        shorten();
+        if (is_last_segment) {
+          output += '/';
+        }
+      } else if (single_dot) {
+        // Only a final single-dot path segment leaves its slash.
+        if (is_last_segment) {
+          output += '/';
+        }
+      } else {
+        const size_t appended_at = output.size();
+        output += '/';
+        if (!needs_percent_encoding ||
+            !ada::unicode::percent_encode<true>(
+                segment, character_sets::PATH_PERCENT_ENCODE, output)) {
+          output.append(segment);
+        }
+        // If url's scheme is "file", url's path is empty, and path_buffer is
+        // a Windows drive letter, then replace the second code point in
+        // path_buffer with U+003A (:).
+        if (is_file && appended_at == path_start &&
+            checkers::is_windows_drive_letter(
+                std::string_view(output).substr(appended_at + 1))) {
+          output[appended_at + 2] = ':';
+        }
+      }
+      segment_start = segment_end + 1;
+    }
+    if (last_block) {
+      return;
+    }
+  }
+}
+
 ada_really_inline void parse_prepared_path(std::string_view input,
                                            ada::scheme::type type,
                                            std::string& path) {
@@ -837,9 +1021,9 @@ ada_really_inline void parse_prepared_path(std::string_view input,
   // character needing percent encoding. Otherwise, we check that we have no %,
   // no dot, and no character needing percent encoding.
   constexpr uint8_t need_encoding = 1;
-  constexpr uint8_t backslash_char = 2;
   constexpr uint8_t dot_char = 4;
   constexpr uint8_t percent_char = 8;
+  constexpr uint8_t dot_segment = 16;
   bool special = type != ada::scheme::NOT_SPECIAL;
   bool may_need_slow_file_handling = (type == ada::scheme::type::FILE &&
                                       checkers::is_windows_drive_letter(input));
@@ -848,15 +1032,21 @@ ada_really_inline void parse_prepared_path(std::string_view input,
                : ((accumulator & (need_encoding | dot_char | percent_char)) ==
                   0)) &&
       (!may_need_slow_file_handling);
-  if (accumulator == dot_char && !may_need_slow_file_handling) {
+  if ((accumulator & ~dot_segment) == dot_char &&
+      !may_need_slow_file_handling) {
     // '4' means that we have at least one dot, but nothing that requires
     // percent encoding or decoding. The only part that is not trivial is
     // that we may have single dots and double dots path segments.
-    // If we have such segments, then we either have a path that begins
-    // with '.' (easy to check), or we have the sequence './'.
+    // If we have such segments, then some segment starts with a dot, which
+    // path_signature reports in the same sweep: without it, the dots are all
+    // within file names (e.g., "index.html") and the path is trivial.
+    // Otherwise, we either have a path that begins with '.' (easy to check),
+    // or we have the sequence './'.
     // Note: input cannot be empty, it must at least contain one character ('.')
     // Note: we know that '\' is not present.
-    if (input[0] != '.') {
+    if ((accumulator & dot_segment) == 0) {
+      trivial_path = true;
+    } else if (input[0] != '.') {
       size_t slashdot = 0;
       bool dot_is_file = true;
       for (;;) {
@@ -879,117 +1069,8 @@ ada_really_inline void parse_prepared_path(std::string_view input,
     path += input;
     return;
   }
-  // We are going to need to look a bit at the path, but let us see if we can
-  // ignore percent encoding *and* backslashes *and* percent characters.
-  // Except for the trivial case, this is likely to capture 99% of paths out
-  // there.
-  bool fast_path =
-      (special &&
-       (accumulator & (need_encoding | backslash_char | percent_char)) == 0) &&
-      (type != ada::scheme::type::FILE);
-  if (fast_path) {
-    ada_log("parse_prepared_path fast");
-    // Here we don't need to worry about \ or percent encoding.
-    // We also do not have a file protocol. We might have dots, however,
-    // but dots must as appear as '.', and they cannot be encoded because
-    // the symbol '%' is not present.
-    size_t previous_location = 0;  // We start at 0.
-    do {
-      size_t new_location = input.find('/', previous_location);
-      // std::string_view path_view = input;
-      //  We process the last segment separately:
-      if (new_location == std::string_view::npos) {
-        std::string_view path_view = input.substr(previous_location);
-        if (path_view == "..") {  // The path ends with ..
-          // e.g., if you receive ".." with an empty path, you go to "/".
-          if (path.empty()) {
-            path = '/';
-            return;
-          }
-          // Fast case where we have nothing to do:
-          if (path.back() == '/') {
-            return;
-          }
-          // If you have the path "/joe/myfriend",
-          // then you delete 'myfriend'.
-          path.resize(path.rfind('/') + 1);
-          return;
-        }
-        path += '/';
-        if (path_view != ".") {
-          path.append(path_view);
-        }
-        return;
-      } else {
-        // This is a non-final segment.
-        std::string_view path_view =
-            input.substr(previous_location, new_location - previous_location);
-        previous_location = new_location + 1;
-        if (path_view == "..") {
-          size_t last_delimiter = path.rfind('/');
-          if (last_delimiter != std::string::npos) {
-            path.erase(last_delimiter);
-          }
-        } else if (path_view != ".") {
-          path += '/';
-          path.append(path_view);
-        }
-      }
-    } while (true);
-  } else {
-    ada_log("parse_path slow");
-    // we have reached the general case
-    bool needs_percent_encoding = (accumulator & 1);
-    std::string path_buffer_tmp;
-    do {
-      size_t location = (special && (accumulator & 2))
-                            ? input.find_first_of("/\\")
-                            : input.find('/');
-      std::string_view path_view = input;
-      if (location != std::string_view::npos) {
-        path_view.remove_suffix(path_view.size() - location);
-        input.remove_prefix(location + 1);
-      }
-      // path_buffer is either path_view or it might point at a percent encoded
-      // temporary file.
-      std::string_view path_buffer =
-          (needs_percent_encoding &&
-           ada::unicode::percent_encode<false>(
-               path_view, character_sets::PATH_PERCENT_ENCODE, path_buffer_tmp))
-              ? path_buffer_tmp
-              : path_view;
-      if (unicode::is_double_dot_path_segment(path_buffer)) {
-        helpers::shorten_path(path, type);
-        if (location == std::string_view::npos) {
-          path += '/';
-        }
-      } else if (unicode::is_single_dot_path_segment(path_buffer) &&
-                 (location == std::string_view::npos)) {
-        path += '/';
-      }
-      // Otherwise, if path_buffer is not a single-dot path segment, then:
-      else if (!unicode::is_single_dot_path_segment(path_buffer)) {
-        // If url's scheme is "file", url's path is empty, and path_buffer is a
-        // Windows drive letter, then replace the second code point in
-        // path_buffer with U+003A (:).
-        if (type == ada::scheme::type::FILE && path.empty() &&
-            checkers::is_windows_drive_letter(path_buffer)) {
-          path += '/';
-          path += path_buffer[0];
-          path += ':';
-          path_buffer.remove_prefix(2);
-          path.append(path_buffer);
-        } else {
-          // Append path_buffer to url's path.
-          path += '/';
-          path.append(path_buffer);
-        }
-      }
-      if (location == std::string_view::npos) {
-        return;
-      }
-    } while (true);
-  }
+  append_normalized_path(input, type, (accumulator & need_encoding) != 0, path,
+                         0);
 }
 
 bool overlaps(std::string_view input1, const std::string& input2) noexcept {
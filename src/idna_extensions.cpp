@@ -0,0 +1,509 @@
+#include "ada/idna_extensions.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "ada/common_defs.h"
+
+#if ADA_NEON
+#include <arm_neon.h>
+#elif ADA_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef ADA_USE_SIMDUTF
+#include "simdutf.h"
+#endif
+
+namespace ada::idna {
+
+bool utf8_to_utf32(std::string_view input, std::u32string& out) {
+  const size_t start = out.size();
+  // There are never more code points than bytes.
+  out.resize(start + input.size());
+  const size_t written =
+      utf8_to_utf32(input.data(), input.size(), out.data() + start);
+  if (written == 0 && !input.empty()) {
+    out.resize(start);
+    return false;
+  }
+  out.resize(start + written);
+  return true;
+}
+
+bool utf32_to_utf8(std::u32string_view input, std::string& out) {
+  const size_t start = out.size();
+  // A code point takes at most four bytes.
+  out.resize(start + 4 * input.size());
+  const size_t written =
+      utf32_to_utf8(input.data(), input.size(), out.data() + start);
+  if (written == 0 && !input.empty()) {
+    out.resize(start);
+    return false;
+  }
+  out.resize(start + written);
+  return true;
+}
+
+namespace {
+
+// A bounded map from inputs to results. Each shard keeps two generations:
+// results are added to the current one and, when it is full, it becomes the
+// previous one and the oldest generation is dropped. A result found in the
+// previous generation moves back to the current one, so that the hosts in
+// use survive while the others age out, without the bookkeeping of an LRU
+// list.
+class result_cache {
+ public:
+  // Longer inputs are not valid domains and are not worth keeping.
+  static constexpr size_t max_input_size = 255;
+
+  void set_capacity(size_t new_capacity) {
+    for (shard& s : shards) {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      s.current.clear();
+      s.previous.clear();
+    }
+    // Each shard holds up to two generations.
+    const size_t limit = std::max<size_t>(new_capacity / (2 * shard_count), 1);
+    generation_limit.store(limit, std::memory_order_relaxed);
+    capacity.store(new_capacity, std::memory_order_relaxed);
+    hits.store(0, std::memory_order_relaxed);
+    misses.store(0, std::memory_order_relaxed);
+  }
+
+  void clear() { set_capacity(get_capacity()); }
+
+  [[nodiscard]] size_t get_capacity() const noexcept {
+    return capacity.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool accepts(std::string_view input) const noexcept {
+    return input.size() <= max_input_size && get_capacity() != 0;
+  }
+
+  // Appends the cached result to out and returns true if input is cached.
+  // The success of the conversion is stored in is_valid.
+  bool find(std::string_view input, std::string& out, bool& is_valid) {
+    const size_t hash = std::hash<std::string_view>{}(input);
+    shard& s = shards[hash % shard_count];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.current.find(input);
+    if (it == s.current.end()) {
+      auto old = s.previous.find(input);
+      if (old == s.previous.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      map_type::node_type node = s.previous.extract(old);
+      s.make_room(generation_limit.load(std::memory_order_relaxed));
+      it = s.current.insert(std::move(node)).position;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    out.append(it->second.value);
+    is_valid = it->second.is_valid;
+    return true;
+  }
+
+  void store(std::string_view input, std::string_view result, bool is_valid) {
+    const size_t hash = std::hash<std::string_view>{}(input);
+    shard& s = shards[hash % shard_count];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.current.contains(input) || s.previous.contains(input)) {
+      return;
+    }
+    s.make_room(generation_limit.load(std::memory_order_relaxed));
+    s.current.emplace(std::string(input),
+                      entry{std::string(result), is_valid});
+  }
+
+  [[nodiscard]] cache_statistics statistics() {
+    cache_statistics result;
+    for (shard& s : shards) {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      result.size += s.current.size() + s.previous.size();
+    }
+    result.hits = hits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    result.capacity = get_capacity();
+    return result;
+  }
+
+ private:
+  struct entry {
+    std::string value;
+    bool is_valid;
+  };
+
+  struct string_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const noexcept {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  using map_type =
+      std::unordered_map<std::string, entry, string_hash, std::equal_to<>>;
+
+  struct shard {
+    std::mutex mutex{};
+    map_type current{};
+    map_type previous{};
+
+    void make_room(size_t limit) {
+      if (current.size() >= limit) {
+        previous = std::move(current);
+        current.clear();
+      }
+    }
+  };
+
+  static constexpr size_t shard_count = 16;
+  std::array<shard, shard_count> shards{};
+  std::atomic<size_t> capacity{0};
+  std::atomic<size_t> generation_limit{0};
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> misses{0};
+};
+
+result_cache& get_to_ascii_cache() {
+  static result_cache cache;
+  return cache;
+}
+
+result_cache& get_to_unicode_cache() {
+  static result_cache cache;
+  return cache;
+}
+
+template <class string_view_type>
+bool is_ascii_string(string_view_type view) noexcept {
+  return std::ranges::all_of(view, [](auto c) { return uint32_t(c) < 0x80; });
+}
+
+// Checks that the part of an "xn--" label after the prefix decodes to a label
+// that IDNA processing would have left unchanged. The buffers are scratch
+// space shared by the labels of a domain.
+bool is_valid_punycode_label(std::string_view puny_segment_ascii,
+                             std::u32string& tmp_buffer,
+                             std::u32string& post_map) {
+  tmp_buffer.clear();
+  if (!punycode_to_utf32(puny_segment_ascii, tmp_buffer)) {
+    return false;
+  }
+  // If the input is just ASCII, it should not have been encoded
+  // as punycode.
+  // https://github.com/whatwg/url/issues/760
+  if (is_ascii_string(std::u32string_view(tmp_buffer))) {
+    return false;
+  }
+  if (!map(tmp_buffer, post_map) || post_map != tmp_buffer) {
+    return false;
+  }
+  normalize(post_map);
+  return post_map == tmp_buffer && is_label_valid(post_map);
+}
+
+// Appends an ASCII label to out. Every ASCII code point is either valid or
+// mapped to its lowercase form, and NFC leaves ASCII unchanged, so mapping
+// the label only requires lowercasing it in place.
+bool append_ascii_label(std::string_view label, std::string& out,
+                        std::u32string& tmp_buffer, std::u32string& post_map) {
+  const size_t label_out_start = out.size();
+  out.append(label);
+  ascii_map(out.data() + label_out_start, label.size());
+  std::string_view mapped_label(out.data() + label_out_start, label.size());
+  if (mapped_label.starts_with("xn--")) {
+    return is_valid_punycode_label(mapped_label.substr(4), tmp_buffer,
+                                   post_map);
+  }
+  return true;
+}
+
+// Appends the labels of a mapped and normalized part of a domain to out.
+// Mapping may produce dots (e.g., from U+3002) so the part can hold several
+// labels.
+bool append_mapped_labels(std::u32string_view mapped, std::string& out,
+                          std::u32string& tmp_buffer,
+                          std::u32string& post_map) {
+  size_t label_start = 0;
+  while (label_start != mapped.size()) {
+    const size_t loc_dot = mapped.find('.', label_start);
+    const bool is_last_label = (loc_dot == std::u32string_view::npos);
+    const size_t label_size =
+        is_last_label ? mapped.size() - label_start : loc_dot - label_start;
+    std::u32string_view label_view(mapped.data() + label_start, label_size);
+    label_start += is_last_label ? label_size : label_size + 1;
+    if (is_ascii_string(label_view)) {
+      // Mapping went to lower case: an "xn--" label cannot be "Xn--".
+      const size_t label_out_start = out.size();
+      out.resize(label_out_start + label_size);
+      std::ranges::transform(label_view, out.begin() + label_out_start,
+                             [](char32_t c) { return char(c); });
+      if (label_view.starts_with(U"xn--") &&
+          !is_valid_punycode_label(
+              std::string_view(out).substr(label_out_start + 4), tmp_buffer,
+              post_map)) {
+        return false;
+      }
+    } else if (label_view.starts_with(U"xn--") ||
+               !is_label_valid(label_view)) {
+      return false;
+    } else {
+      out.append("xn--");
+      if (!utf32_to_punycode(label_view, out)) {
+        return false;
+      }
+    }
+    if (!is_last_label) {
+      out.push_back('.');
+    }
+  }
+  return true;
+}
+
+// The domain is processed one label at a time, splitting on the ASCII dots of
+// the input. Mapping and normalization never carry over an ASCII dot, so an
+// ASCII label is only lowercased and copied, and only the labels with non-
+// ASCII code points are converted to UTF-32, mapped, normalized and encoded.
+// Such a label may still map to several labels, e.g., when it holds U+3002.
+bool append_ascii_domain(std::string_view ut8_string, std::string& out,
+                         scratch_buffers& scratch) {
+  out.reserve(out.size() + ut8_string.size());
+  size_t label_start = 0;
+  while (label_start != ut8_string.size()) {
+    const size_t loc_dot = ut8_string.find('.', label_start);
+    const bool is_last_label = (loc_dot == std::string_view::npos);
+    const size_t label_size =
+        is_last_label ? ut8_string.size() - label_start : loc_dot - label_start;
+    std::string_view label_view(ut8_string.data() + label_start, label_size);
+    label_start += is_last_label ? label_size : label_size + 1;
+    if (is_ascii_string(label_view)) {
+      if (!append_ascii_label(label_view, out, scratch.tmp_buffer,
+                              scratch.post_map)) {
+        return false;
+      }
+    } else {
+      // An ASCII dot is never part of a multi-byte sequence, so the label is
+      // valid UTF-8 if the domain is.
+      scratch.utf32.clear();
+#ifdef ADA_USE_SIMDUTF
+      scratch.utf32.resize(
+          simdutf::utf32_length_from_utf8(label_view.data(), label_size));
+      if (simdutf::convert_utf8_to_utf32(label_view.data(), label_size,
+                                         scratch.utf32.data()) == 0) {
+        return false;
+      }
+#else
+      if (!utf8_to_utf32(label_view, scratch.utf32)) {
+        return false;
+      }
+#endif
+      if (!map(scratch.utf32, scratch.mapped)) {
+        return false;
+      }
+      normalize(scratch.mapped);
+      if (!append_mapped_labels(scratch.mapped, out, scratch.tmp_buffer,
+                                scratch.post_map)) {
+        return false;
+      }
+    }
+    if (!is_last_label) {
+      out.push_back('.');
+    }
+  }
+  return true;
+}
+
+void append_unicode_domain(std::string_view input, std::string& output,
+                           scratch_buffers& scratch) {
+  output.reserve(output.size() + input.size());
+  size_t label_start = 0;
+  while (label_start < input.size()) {
+    const size_t loc_dot = input.find('.', label_start);
+    const bool is_last_label = (loc_dot == std::string_view::npos);
+    const size_t label_size =
+        is_last_label ? input.size() - label_start : loc_dot - label_start;
+    std::string_view label_view(input.data() + label_start, label_size);
+    scratch.tmp_buffer.clear();
+    // ToUnicode never fails. If any step fails, then the original input
+    // sequence is returned immediately in that step.
+    if (!label_view.starts_with("xn--") || !is_ascii_string(label_view) ||
+        !punycode_to_utf32(label_view.substr(4), scratch.tmp_buffer) ||
+        !utf32_to_utf8(scratch.tmp_buffer, output)) {
+      output.append(label_view);
+    }
+    if (!is_last_label) {
+      output.push_back('.');
+    }
+    label_start += label_size + 1;
+  }
+}
+
+// Classifies an input for the batch fast paths in a single pass: whether it
+// only has ASCII characters, and whether it holds "--", without which no
+// label can start with "xn--" (in any case).
+struct input_class {
+  bool is_ascii;
+  bool has_double_hyphen;
+};
+
+input_class classify(std::string_view input) noexcept {
+  const auto* data = reinterpret_cast<const uint8_t*>(input.data());
+  const size_t size = input.size();
+  size_t i = 0;
+  bool non_ascii = false;
+  bool double_hyphen = false;
+#if ADA_NEON
+  const uint8x16_t hyphen = vdupq_n_u8('-');
+  uint8x16_t any = vdupq_n_u8(0);
+  uint8x16_t hyphens = vdupq_n_u8(0);
+  // The second load is one byte ahead, so that a lane sees a byte and the
+  // one after it.
+  for (; i + 17 <= size; i += 16) {
+    const uint8x16_t a = vld1q_u8(data + i);
+    const uint8x16_t b = vld1q_u8(data + i + 1);
+    any = vorrq_u8(any, a);
+    hyphens = vorrq_u8(hyphens,
+                       vandq_u8(vceqq_u8(a, hyphen), vceqq_u8(b, hyphen)));
+  }
+  non_ascii = vmaxvq_u8(any) >= 0x80;
+  double_hyphen = vmaxvq_u8(hyphens) != 0;
+#elif ADA_SSE2
+  const __m128i hyphen = _mm_set1_epi8('-');
+  __m128i any = _mm_setzero_si128();
+  __m128i hyphens = _mm_setzero_si128();
+  // The second load is one byte ahead, so that a lane sees a byte and the
+  // one after it.
+  for (; i + 17 <= size; i += 16) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+    any = _mm_or_si128(any, a);
+    hyphens = _mm_or_si128(hyphens, _mm_and_si128(_mm_cmpeq_epi8(a, hyphen),
+                                                  _mm_cmpeq_epi8(b, hyphen)));
+  }
+  non_ascii = _mm_movemask_epi8(any) != 0;
+  double_hyphen = _mm_movemask_epi8(hyphens) != 0;
+#endif
+  uint8_t tail = 0;
+  for (; i < size; i++) {
+    tail |= data[i];
+    double_hyphen |= data[i] == '-' && i + 1 < size && data[i + 1] == '-';
+  }
+  return {!non_ascii && tail < 0x80, double_hyphen};
+}
+
+void start_batch(std::span<const std::string_view> inputs,
+                 batch_results& out) {
+  size_t total_size = 0;
+  for (std::string_view input : inputs) {
+    total_size += input.size();
+  }
+  out.data.clear();
+  out.data.reserve(total_size);
+  out.offsets.clear();
+  out.offsets.reserve(inputs.size() + 1);
+  out.offsets.push_back(0);
+}
+
+}  // namespace
+
+void set_cache_capacity(size_t capacity) {
+  get_to_ascii_cache().set_capacity(capacity);
+  get_to_unicode_cache().set_capacity(capacity);
+}
+
+size_t get_cache_capacity() noexcept {
+  return get_to_ascii_cache().get_capacity();
+}
+
+void clear_cache() {
+  get_to_ascii_cache().clear();
+  get_to_unicode_cache().clear();
+}
+
+cache_statistics get_to_ascii_cache_statistics() {
+  return get_to_ascii_cache().statistics();
+}
+
+cache_statistics get_to_unicode_cache_statistics() {
+  return get_to_unicode_cache().statistics();
+}
+
+bool to_ascii(std::string_view ut8_string, std::string& out,
+              scratch_buffers& scratch) {
+  const size_t out_start = out.size();
+  result_cache& cache = get_to_ascii_cache();
+  const bool use_cache =
+      cache.accepts(ut8_string) && !is_ascii_string(ut8_string);
+  bool is_valid{};
+  if (use_cache && cache.find(ut8_string, out, is_valid)) {
+    return is_valid;
+  }
+  is_valid = append_ascii_domain(ut8_string, out, scratch);
+  if (!is_valid) {
+    out.resize(out_start);
+  }
+  if (use_cache) {
+    cache.store(ut8_string, std::string_view(out).substr(out_start), is_valid);
+  }
+  return is_valid;
+}
+
+void to_unicode(std::string_view input, std::string& output,
+                scratch_buffers& scratch) {
+  result_cache& cache = get_to_unicode_cache();
+  if (!cache.accepts(input) || input.find("xn--") == std::string_view::npos) {
+    append_unicode_domain(input, output, scratch);
+    return;
+  }
+  bool is_valid{};
+  if (cache.find(input, output, is_valid)) {
+    return;
+  }
+  const size_t output_start = output.size();
+  append_unicode_domain(input, output, scratch);
+  cache.store(input, std::string_view(output).substr(output_start), true);
+}
+
+size_t to_ascii_batch(std::span<const std::string_view> inputs,
+                      batch_results& out) {
+  start_batch(inputs, out);
+  scratch_buffers scratch;
+  size_t failures = 0;
+  for (std::string_view input : inputs) {
+    const input_class c = classify(input);
+    if (c.is_ascii && !c.has_double_hyphen) {
+      const size_t start = out.data.size();
+      out.data.append(input);
+      ascii_map(out.data.data() + start, input.size());
+    } else if (!to_ascii(input, out.data, scratch)) {
+      failures++;
+    }
+    out.offsets.push_back(out.data.size());
+  }
+  return failures;
+}
+
+void to_unicode_batch(std::span<const std::string_view> inputs,
+                      batch_results& out) {
+  start_batch(inputs, out);
+  scratch_buffers scratch;
+  for (std::string_view input : inputs) {
+    if (classify(input).has_double_hyphen) {
+      to_unicode(input, out.data, scratch);
+    } else {
+      out.data.append(input);
+    }
+    out.offsets.push_back(out.data.size());
+  }
+}
+
+}  // namespace ada::idna
@@ -1,5 +1,6 @@
 #include "ada/implementation-inl.h"
 
+#include <algorithm>
 #include <atomic>
 #include <limits>
 #include <optional>
@@ -220,9 +221,9 @@ skip_extra_slashes:
 
   if (all_dec_dots) {
     // Host is all decimal digits and dots -> try the fast IPv4 parser.
-    if (checkers::try_parse_ipv4_fast({host_ptr, host_len}) !=
-        checkers::ipv4_fast_fail) {
-      // Valid decimal IPv4 host.  Do NOT return true yet: the port still
+    if ((checkers::try_parse_ipv4_fast({host_ptr, host_len}) &
+         checkers::ipv4_fast_fail) == 0) {
+      // Valid IPv4 host.  Do NOT return true yet: the port still
       // needs to be validated below before we can declare the URL valid.
       goto validate_port;
     }
@@ -233,12 +234,17 @@ skip_extra_slashes:
 
   // Last-significant-character heuristic for non-decimal IPv4 (hex/octal):
   // if the last non-dot char is a digit, 'a'-'f', or 'x' the host might be
-  // an IPv4 address that the fast path can't validate -- fall through.
+  // an IPv4 address. The fast parser accepts the hexadecimal, octal and
+  // short forms; anything else falls through to the full parser.
   // last_non_dot was tracked during the authority scan above.
   {
     const uint8_t lc = last_non_dot | 0x20;
     if ((last_non_dot >= '0' && last_non_dot <= '9') ||
         (lc >= 'a' && lc <= 'f') || lc == 'x') {
+      if ((checkers::try_parse_ipv4_fast({host_ptr, host_len}) &
+           checkers::ipv4_fast_fail) == 0) {
+        goto validate_port;
+      }
       return std::nullopt;
     }
   }
@@ -287,6 +293,85 @@ template ada::result<url> parse<url>(std::string_view input,
 template ada::result<url_aggregator> parse<url_aggregator>(
     std::string_view input, const url_aggregator* base_url = nullptr);
 
+template <class result_type>
+ada_warn_unused tl::expected<result_type, errors> parse(
+    std::string_view input, const parse_options& options,
+    const result_type* base_url) {
+  result_type u =
+      ada::parser::parse_url_impl<result_type>(input, base_url, &options);
+  if (!u.is_valid) {
+    return tl::unexpected(errors::type_error);
+  }
+  return u;
+}
+
+template ada::result<url> parse<url>(std::string_view input,
+                                     const parse_options& options,
+                                     const url* base_url);
+template ada::result<url_aggregator> parse<url_aggregator>(
+    std::string_view input, const parse_options& options,
+    const url_aggregator* base_url);
+
+bool parse_into(url_aggregator& dst, std::string_view input,
+                const url_aggregator* base_url) {
+  // The base is read during parsing, so we cannot take its buffer away.
+  url_aggregator* recycled = (base_url == &dst) ? nullptr : &dst;
+  dst = ada::parser::parse_url_impl<url_aggregator>(input, base_url, nullptr,
+                                                     recycled);
+  return dst.is_valid;
+}
+
+ada::result<url_aggregator> parse_from_parts(std::string_view scheme,
+                                             std::string_view authority,
+                                             std::string_view path_and_query) {
+  url_aggregator u =
+      ada::parser::parse_from_parts(scheme, authority, path_and_query);
+  if (!u.is_valid) {
+    return tl::unexpected(errors::type_error);
+  }
+  return u;
+}
+
+request_target_form get_request_target_form(std::string_view method,
+                                            std::string_view target) noexcept {
+  if (method == "CONNECT") {
+    return request_target_form::authority;
+  }
+  if (target.starts_with('/')) {
+    return request_target_form::origin;
+  }
+  // Only a server-wide OPTIONS request uses the asterisk-form.
+  if (target == "*" && method == "OPTIONS") {
+    return request_target_form::asterisk;
+  }
+  return request_target_form::absolute;
+}
+
+ada::result<url_aggregator> parse_request_target(std::string_view method,
+                                                 std::string_view target,
+                                                 std::string_view host_header,
+                                                 std::string_view scheme) {
+  switch (get_request_target_form(method, target)) {
+    case request_target_form::origin:
+      return parse_from_parts(scheme, host_header, target);
+    case request_target_form::absolute:
+      return parse<url_aggregator>(target);
+    case request_target_form::authority: {
+      // The port of an authority-form target is required.
+      size_t colon = target.rfind(':');
+      if (colon == std::string_view::npos || colon + 1 == target.size() ||
+          !std::ranges::all_of(target.substr(colon + 1), checkers::is_digit) ||
+          target.find_first_of("/?#") != std::string_view::npos) {
+        return tl::unexpected(errors::type_error);
+      }
+      return parse_from_parts(scheme, target, "");
+    }
+    case request_target_form::asterisk:
+      return parse_from_parts(scheme, host_header, "");
+  }
+  return tl::unexpected(errors::type_error);
+}
+
 std::string href_from_file(std::string_view input) {
   // This is going to be much faster than constructing a URL.
   std::string tmp_buffer;
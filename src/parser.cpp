@@ -1,5 +1,6 @@
 #include "ada/parser-inl.h"
 
+#include <algorithm>
 #include <limits>
 #include <ranges>
 
@@ -14,9 +15,30 @@
 
 namespace ada::parser {
 
-template <class result_type, bool store_values>
+namespace {
+// The input without its tabs and newlines. It is kept per thread so that
+// removing them does not allocate once the buffer has grown to fit the
+// inputs; parse_url_impl never runs another parse while it reads from it. A
+// buffer that a pathological input grew past max_retained_pruned_input is
+// released on the next call.
+constexpr size_t max_retained_pruned_input = 1024;
+
+std::string& get_pruned_input(std::string_view user_input) {
+  static thread_local std::string pruned;
+  if (pruned.capacity() > max_retained_pruned_input) {
+    std::string().swap(pruned);
+  }
+  pruned.assign(user_input);
+  helpers::remove_ascii_tab_or_newline(pruned);
+  return pruned;
+}
+}  // namespace
+
+template <class result_type, bool store_values, bool plain_input>
 result_type parse_url_impl(std::string_view user_input,
-                           const result_type* base_url) {
+                           const result_type* base_url,
+                           const parse_options* options,
+                           [[maybe_unused]] result_type* recycled) {
   // We can specialize the implementation per type.
   // Important: result_type_is_ada_url is evaluated at *compile time*. This
   // means that doing if constexpr(result_type_is_ada_url) { something } else {
@@ -33,14 +55,42 @@ result_type parse_url_impl(std::string_view user_input,
           " bytes],", (base_url != nullptr ? base_url->to_string() : "null"),
           ")");
 
+  // A single pass tells us which uncommon characters the input holds. Most
+  // URLs have none of them (no tab, newline, backslash, credentials or byte
+  // to percent-encode), and we then continue with an instantiation where the
+  // branches they need are compiled out.
+  uint8_t input_features = 0;
+  size_t percent_encoded_bytes = 0;
+  if constexpr (!plain_input) {
+    input_features =
+        unicode::input_features(user_input, percent_encoded_bytes);
+    if (input_features == 0) {
+      return parse_url_impl<result_type, store_values, true>(
+          user_input, base_url, options, recycled);
+    }
+  }
+
+
   state state = state::SCHEME_START;
   result_type url{};
+  if constexpr (result_type_is_ada_url_aggregator && store_values) {
+    // Reuse the capacity of a previous result, see ada::parse_into, unless
+    // the input is a view into it (e.g., when reparsing its own href): we
+    // are about to overwrite that buffer.
+    if (recycled != nullptr &&
+        !helpers::overlaps(user_input, recycled->buffer)) {
+      url.buffer.swap(recycled->buffer);
+      url.buffer.clear();
+    }
+  }
 
-  const uint32_t max_input_length = ada::get_max_input_length();
+  const uint32_t max_input_length = options != nullptr
+                                        ? options->max_input_length
+                                        : ada::get_max_input_length();
 
   // We refuse to parse URL strings that exceed the maximum input length.
   // By default, this is 4GB but can be configured via
-  // ada::set_max_input_length().
+  // ada::set_max_input_length() or per call with ada::parse_options.
   if (user_input.size() > max_input_length) [[unlikely]] {
     url.is_valid = false;
   }
@@ -62,30 +112,35 @@ result_type parse_url_impl(std::string_view user_input,
     // for performance. If you have a benchmark with small inputs,
     // it may not matter, but in other instances, it could.
     ////
-    // This rounds up to the next power of two.
-    // We know that user_input.size() is in [0,
-    // std::numeric_limits<uint32_t>::max).
+    // A relative input is resolved against the base, so the result may need
+    // as much room as both combined: growing the buffer later would cost
+    // another allocation. For the same reason, we count the bytes that a
+    // component may percent-encode: each of them can become three.
+    size_t expected_size = user_input.size() + 2 * percent_encoded_bytes;
+    if (base_url != nullptr) {
+      expected_size += base_url->get_href().size();
+    }
+    // This rounds up to the next power of two, at most 2^31: larger inputs
+    // grow the buffer as needed.
+    expected_size = std::min<size_t>(expected_size, 0x7FFFFFFF);
     uint32_t reserve_capacity =
-        (0xFFFFFFFF >>
-         helpers::leading_zeroes(uint32_t(1 | user_input.size()))) +
+        (0xFFFFFFFF >> helpers::leading_zeroes(uint32_t(1 | expected_size))) +
         1;
     url.reserve(reserve_capacity);
   }
-  std::string tmp_buffer;
   std::string_view url_data;
-  if (unicode::has_tabs_or_newline(user_input)) [[unlikely]] {
-    tmp_buffer = user_input;
-    // Optimization opportunity: Instead of copying and then pruning, we could
-    // just directly build the string from user_input.
-    helpers::remove_ascii_tab_or_newline(tmp_buffer);
-    url_data = tmp_buffer;
+  if (!plain_input &&
+      (input_features & unicode::input_has_tabs_or_newline)) [[unlikely]] {
+    url_data = get_pruned_input(user_input);
   } else [[likely]] {
     url_data = user_input;
   }
 
   // Leading and trailing control characters are uncommon and easy to deal with
   // (no performance concern).
-  helpers::trim_c0_whitespace(url_data);
+  if (options == nullptr || !options->input_is_trimmed) {
+    helpers::trim_c0_whitespace(url_data);
+  }
 
   // Optimization opportunity. Most websites do not have fragment.
   std::optional<std::string_view> fragment = helpers::prune_hash(url_data);
@@ -247,12 +302,12 @@ result_type parse_url_impl(std::string_view user_input,
         // worry about AUTHORITY.
         // TODO: Instead of just collecting a bool, collect the location of the
         // '@' and do something useful with it.
-        // TODO: We could do various processing early on, using a single pass
-        // over the string to collect information about it, e.g., telling us
-        // whether there is a @ and if so, where (or how many).
+        // The input_features pass already told us whether there is a @
+        // anywhere in the input.
 
         // Check if url data contains an @.
-        if (url_data.find('@', input_position) == std::string_view::npos) {
+        if (plain_input || (input_features & unicode::input_has_at_sign) == 0 ||
+            url_data.find('@', input_position) == std::string_view::npos) {
           state = state::HOST;
           break;
         }
@@ -305,9 +360,9 @@ result_type parse_url_impl(std::string_view user_input,
                         authority_view,
                         character_sets::USERINFO_PERCENT_ENCODE);
                   } else {
-                    url.append_base_username(unicode::percent_encode(
+                    url.append_base_username(
                         authority_view,
-                        character_sets::USERINFO_PERCENT_ENCODE));
+                        character_sets::USERINFO_PERCENT_ENCODE);
                   }
                 } else {
                   if constexpr (result_type_is_ada_url) {
@@ -318,12 +373,12 @@ result_type parse_url_impl(std::string_view user_input,
                         authority_view.substr(password_token_location + 1),
                         character_sets::USERINFO_PERCENT_ENCODE);
                   } else {
-                    url.append_base_username(unicode::percent_encode(
+                    url.append_base_username(
                         authority_view.substr(0, password_token_location),
-                        character_sets::USERINFO_PERCENT_ENCODE));
-                    url.append_base_password(unicode::percent_encode(
+                        character_sets::USERINFO_PERCENT_ENCODE);
+                    url.append_base_password(
                         authority_view.substr(password_token_location + 1),
-                        character_sets::USERINFO_PERCENT_ENCODE));
+                        character_sets::USERINFO_PERCENT_ENCODE);
                   }
                 }
               }
@@ -332,8 +387,8 @@ result_type parse_url_impl(std::string_view user_input,
                 url.password += unicode::percent_encode(
                     authority_view, character_sets::USERINFO_PERCENT_ENCODE);
               } else {
-                url.append_base_password(unicode::percent_encode(
-                    authority_view, character_sets::USERINFO_PERCENT_ENCODE));
+                url.append_base_password(
+                    authority_view, character_sets::USERINFO_PERCENT_ENCODE);
               }
             }
           }
@@ -415,7 +470,8 @@ result_type parse_url_impl(std::string_view user_input,
               "RELATIVE_SCHEME if c is U+002F (/), then set state to relative "
               "slash state");
           state = state::RELATIVE_SLASH;
-        } else if (url.is_special() && (input_position != input_size) &&
+        } else if (!plain_input && url.is_special() &&
+                   (input_position != input_size) &&
                    (url_data[input_position] == '\\')) {
           // Otherwise, if url is special and c is U+005C (\), validation error,
           // set state to relative slash state.
@@ -473,7 +529,7 @@ result_type parse_url_impl(std::string_view user_input,
             } else {
               std::string_view path = url.get_pathname();
               if (helpers::shorten_path(path, url.type)) {
-                url.update_base_pathname(std::move(std::string(path)));
+                url.shorten_base_pathname(uint32_t(path.size()));
               }
             }
             // Set state to path state and decrease pointer by 1.
@@ -492,7 +548,7 @@ result_type parse_url_impl(std::string_view user_input,
         // NOLINTNEXTLINE(bugprone-branch-clone)
         if (url.is_special() && (input_position != input_size) &&
             (url_data[input_position] == '/' ||
-             url_data[input_position] == '\\')) {
+             (!plain_input && url_data[input_position] == '\\'))) {
           // Set state to special authority ignore slashes state.
           state = state::SPECIAL_AUTHORITY_IGNORE_SLASHES;
         }
@@ -547,7 +603,7 @@ result_type parse_url_impl(std::string_view user_input,
         // authority state and decrease pointer by 1.
         while ((input_position != input_size) &&
                ((url_data[input_position] == '/') ||
-                (url_data[input_position] == '\\'))) {
+                (!plain_input && url_data[input_position] == '\\'))) {
           input_position++;
         }
         state = state::AUTHORITY;
@@ -591,7 +647,7 @@ result_type parse_url_impl(std::string_view user_input,
           // Let host be the result of host parsing buffer with url is not
           // special.
           ada_log("HOST parsing ", host_view);
-          if (!url.parse_host(host_view)) {
+          if (!url.parse_host(host_view, options)) {
             return url;
           }
           ada_log("HOST parsing results in ", url.get_hostname());
@@ -617,7 +673,7 @@ result_type parse_url_impl(std::string_view user_input,
           // special.
           if (host_view.empty()) {
             url.update_base_hostname("");
-          } else if (!url.parse_host(host_view)) {
+          } else if (!url.parse_host(host_view, options)) {
             return url;
           }
           ada_log("HOST parsing results in ", url.get_hostname(),
@@ -662,9 +718,12 @@ result_type parse_url_impl(std::string_view user_input,
               std::string(view.substr(0, view.size() - 1)) + "%20";
           url.update_base_pathname(unicode::percent_encode(
               modified_view, character_sets::C0_CONTROL_PERCENT_ENCODE));
-        } else {
+        } else if constexpr (result_type_is_ada_url) {
           url.update_base_pathname(unicode::percent_encode(
               view, character_sets::C0_CONTROL_PERCENT_ENCODE));
+        } else {
+          url.update_base_pathname(view,
+                                   character_sets::C0_CONTROL_PERCENT_ENCODE);
         }
         break;
       }
@@ -708,7 +767,7 @@ result_type parse_url_impl(std::string_view user_input,
           // by 1. We know that (input_position == input_size) is impossible
           // here, because of the previous if-check.
           if ((url_data[input_position] != '/') &&
-              (url_data[input_position] != '\\')) {
+              (plain_input || url_data[input_position] != '\\')) {
             break;
           }
         }
@@ -843,7 +902,7 @@ result_type parse_url_impl(std::string_view user_input,
           input_position += consumed_bytes;
           // Let host be the result of host parsing buffer with url is not
           // special.
-          if (!url.parse_host(file_host_buffer)) {
+          if (!url.parse_host(file_host_buffer, options)) {
             return url;
           }
 
@@ -922,7 +981,7 @@ result_type parse_url_impl(std::string_view user_input,
               } else {
                 std::string_view path = url.get_pathname();
                 if (helpers::shorten_path(path, url.type)) {
-                  url.update_base_pathname(std::move(std::string(path)));
+                  url.shorten_base_pathname(uint32_t(path.size()));
                 }
               }
             }
@@ -976,12 +1035,156 @@ result_type parse_url_impl(std::string_view user_input,
   return url;
 }
 
-template url parse_url_impl<url, true>(std::string_view user_input,
-                                       const url* base_url = nullptr);
 template url_aggregator parse_url_impl<url_aggregator, true>(
-    std::string_view user_input, const url_aggregator* base_url = nullptr);
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
 template url_aggregator parse_url_impl<url_aggregator, false>(
-    std::string_view user_input, const url_aggregator* base_url = nullptr);
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
+template url parse_url_impl<url, true>(
+    std::string_view user_input, const url* base_url,
+    const parse_options* options, url* recycled);
+template url_aggregator parse_url_impl<url_aggregator, true, true>(
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
+template url_aggregator parse_url_impl<url_aggregator, false, true>(
+    std::string_view user_input, const url_aggregator* base_url,
+    const parse_options* options, url_aggregator* recycled);
+template url parse_url_impl<url, true, true>(
+    std::string_view user_input, const url* base_url,
+    const parse_options* options, url* recycled);
+
+url_aggregator parse_from_parts(std::string_view scheme,
+                                std::string_view authority,
+                                std::string_view path_and_query) {
+  ada_log("parse_from_parts ", scheme, " ", authority, " ", path_and_query);
+  url_aggregator url{};
+  auto fail = [&url]() {
+    url.is_valid = false;
+    return url;
+  };
+  // The parser removes ASCII tabs and newlines from its input, these are the
+  // only parts that may need a copy.
+  std::string scheme_buffer, authority_buffer, path_buffer;
+  auto remove_tabs_or_newline = [](std::string_view& view,
+                                   std::string& storage) {
+    if (unicode::has_tabs_or_newline(view)) [[unlikely]] {
+      storage = view;
+      helpers::remove_ascii_tab_or_newline(storage);
+      view = storage;
+    }
+  };
+  remove_tabs_or_newline(scheme, scheme_buffer);
+  remove_tabs_or_newline(authority, authority_buffer);
+  remove_tabs_or_newline(path_and_query, path_buffer);
+  // The parser trims C0 controls and spaces from both ends of its input: the
+  // start of the scheme and the end of the path, or of the authority when
+  // the path is empty.
+  while (!scheme.empty() && unicode::is_c0_control_or_space(scheme.front())) {
+    scheme.remove_prefix(1);
+  }
+  auto trim_end = [](std::string_view& view) {
+    while (!view.empty() && unicode::is_c0_control_or_space(view.back())) {
+      view.remove_suffix(1);
+    }
+  };
+  trim_end(path_and_query);
+  if (path_and_query.empty()) {
+    trim_end(authority);
+  }
+
+  // The result is the scheme, "://", the authority and the path: we reserve
+  // as the parser would for the concatenation.
+  const size_t expected_size =
+      scheme.size() + 3 + authority.size() + path_and_query.size();
+  if (expected_size > ada::get_max_input_length()) {
+    return fail();
+  }
+  url.reserve(
+      (0xFFFFFFFF >> helpers::leading_zeroes(uint32_t(1 | expected_size))) + 1);
+
+  // Scheme state, we lower the scheme where it lands in the buffer.
+  if (scheme.empty() || !checkers::is_alpha(scheme[0]) ||
+      !std::ranges::all_of(scheme, unicode::is_alnum_plus)) {
+    return fail();
+  }
+  url.buffer.append(scheme);
+  url.buffer += ':';
+  unicode::to_lower_ascii(url.buffer.data(), scheme.size());
+  url.type = scheme::get_scheme_type(
+      std::string_view(url.buffer.data(), scheme.size()));
+  url.components.protocol_end = uint32_t(url.buffer.size());
+  url.components.username_end = url.components.protocol_end;
+  url.components.host_start = url.components.protocol_end;
+  url.components.host_end = url.components.protocol_end;
+  url.components.pathname_start = url.components.protocol_end;
+  // File hosts follow other rules and never come from an HTTP request.
+  if (url.type == scheme::type::FILE) {
+    return fail();
+  }
+
+  // Host and port states. HTTP/2 and HTTP/3 forbid credentials in the
+  // authority, and a delimiter would end the authority early. Special URLs
+  // need a host: the parser would look for one in the path.
+  if (authority.find_first_of(url.is_special() ? "@/?#\\" : "@/?#") !=
+          std::string_view::npos ||
+      (url.is_special() && authority.empty())) {
+    return fail();
+  }
+  url.add_authority_slashes_if_needed();
+  std::string_view host_view = authority;
+  auto [location, found_colon] =
+      helpers::get_host_delimiter_location(url.is_special(), host_view);
+  if (host_view.empty()) {
+    if (url.is_special() || found_colon) {
+      return fail();
+    }
+    url.update_base_hostname("");
+  } else if (!url.parse_host(host_view)) {
+    return fail();
+  }
+  if (found_colon) {
+    std::string_view port_view = authority.substr(location + 1);
+    if (url.parse_port(port_view, true) != port_view.size() || !url.is_valid) {
+      return fail();
+    }
+  }
+
+  // Path start, path, query and fragment states.
+  std::optional<std::string_view> fragment =
+      helpers::prune_hash(path_and_query);
+  if (!path_and_query.empty() && path_and_query[0] != '/' &&
+      path_and_query[0] != '?' &&
+      !(url.is_special() && path_and_query[0] == '\\')) {
+    return fail();
+  }
+  std::string_view path = path_and_query;
+  std::optional<std::string_view> query;
+  if (size_t question_mark = path.find('?');
+      question_mark != std::string_view::npos) {
+    query = path.substr(question_mark + 1);
+    path = path.substr(0, question_mark);
+  }
+  if (!path.empty()) {
+    url.consume_prepared_path(path.substr(1));
+  } else if (url.is_special()) {
+    url.update_base_pathname("/");
+  }
+  if (query.has_value()) {
+    url.update_base_search(*query,
+                           url.is_special()
+                               ? character_sets::SPECIAL_QUERY_PERCENT_ENCODE
+                               : character_sets::QUERY_PERCENT_ENCODE);
+  }
+  if (fragment.has_value()) {
+    url.update_unencoded_base_hash(*fragment);
+  }
+  if (url.buffer.size() > ada::get_max_input_length()) {
+    return fail();
+  }
+  ADA_ASSERT_TRUE(url.validate());
+  return url;
+}
 
 template <class result_type>
 result_type parse_url(std::string_view user_input,
@@ -0,0 +1,60 @@
+#include "ada/query_filter.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace ada {
+
+void query_filter::add(std::string_view key) {
+  bool is_prefix = key.ends_with('*');
+  if (is_prefix) {
+    key.remove_suffix(1);
+  }
+  if (key.empty()) {
+    bool& flag = is_prefix ? matches_everything : has_empty_key;
+    if (!flag) {
+      flag = true;
+      key_count++;
+    }
+    return;
+  }
+  auto position = std::ranges::lower_bound(
+      entries, key, std::less<>{},
+      [](const entry& e) -> std::string_view { return e.key; });
+  for (auto it = position; it != entries.end() && it->key == key; ++it) {
+    if (it->is_prefix == is_prefix) {
+      // We already have this key.
+      return;
+    }
+  }
+  entries.insert(position, entry{std::string(key), is_prefix});
+  const uint8_t first = uint8_t(key[0]);
+  first_bytes[first / 64] |= uint64_t(1) << (first % 64);
+  key_count++;
+}
+
+bool query_filter::contains(std::string_view key) const noexcept {
+  if (matches_everything) {
+    return true;
+  }
+  if (key.empty()) {
+    return has_empty_key;
+  }
+  const uint8_t first = uint8_t(key[0]);
+  if ((first_bytes[first / 64] & (uint64_t(1) << (first % 64))) == 0) {
+    return false;
+  }
+  // The entries that are equal to the key or a prefix of it sort between the
+  // first entry starting with the same byte and the key itself.
+  auto it = std::ranges::lower_bound(
+      entries, key.substr(0, 1), std::less<>{},
+      [](const entry& e) -> std::string_view { return e.key; });
+  for (; it != entries.end() && std::string_view(it->key) <= key; ++it) {
+    if (it->is_prefix ? key.starts_with(it->key) : key == it->key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace ada
@@ -22,7 +22,7 @@ void find_longest_sequence_of_ipv6_pieces(
   }
 }
 
-std::string ipv6(const std::array<uint16_t, 8>& address) {
+size_t ipv6(const std::array<uint16_t, 8>& address, char* output) noexcept {
   size_t compress_length = 0;  // The length of a long sequence of zeros.
   size_t compress = 0;         // The start of a long sequence of zeros.
   find_longest_sequence_of_ipv6_pieces(address, compress, compress_length);
@@ -33,10 +33,9 @@ std::string ipv6(const std::array<uint16_t, 8>& address) {
     compress = compress_length = 8;
   }
 
-  std::string output(4 * 8 + 7 + 2, '\0');
   size_t piece_index = 0;
-  char* point = output.data();
-  char* point_end = output.data() + output.size();
+  char* point = output;
+  char* point_end = output + ipv6_max_length;
   *point++ = '[';
   while (true) {
     if (piece_index == compress) {
@@ -59,7 +58,12 @@ std::string ipv6(const std::array<uint16_t, 8>& address) {
     *point++ = ':';
   }
   *point++ = ']';
-  output.resize(point - output.data());
+  return size_t(point - output);
+}
+
+std::string ipv6(const std::array<uint16_t, 8>& address) {
+  std::string output(ipv6_max_length, '\0');
+  output.resize(ipv6(address, output.data()));
   return output;
 }
 
@@ -3,6 +3,7 @@
 #include "ada/character_sets-inl.h"
 #include "ada/character_sets.h"
 #include "ada/common_defs.h"
+#include "ada/idna_extensions.h"
 #include "ada/log.h"
 
 ADA_PUSH_DISABLE_ALL_WARNINGS
@@ -22,6 +23,8 @@ ADA_POP_DISABLE_WARNINGS
 #include <riscv_vector.h>
 #endif
 
+#include <bit>
+#include <cstring>
 #include <ranges>
 
 namespace ada::unicode {
@@ -239,6 +242,168 @@ ada_really_inline bool has_tabs_or_newline(
 }
 #endif
 
+constexpr static std::array<uint8_t, 256> input_feature_table = []() consteval {
+  std::array<uint8_t, 256> result{};
+  for (size_t c = 0; c < 256; c++) {
+    if (c <= ' ' || c >= 0x7f) {
+      result[c] = input_has_percent_encoded_bytes;
+    }
+  }
+  for (uint8_t c : {'"', '\'', '<', '>', '^', '`', '{', '}'}) {
+    result[c] = input_has_percent_encoded_bytes;
+  }
+  for (uint8_t c : {'\t', '\n', '\r'}) {
+    result[c] |= input_has_tabs_or_newline;
+  }
+  result['\\'] = input_has_backslash;
+  result['@'] = input_has_at_sign;
+  return result;
+}();
+
+ada_really_inline uint8_t input_features_scalar(
+    std::string_view input, size_t& percent_encoded_bytes) noexcept {
+  uint8_t result = 0;
+  for (char c : input) {
+    uint8_t features = input_feature_table[uint8_t(c)];
+    result |= features;
+    percent_encoded_bytes +=
+        (features & input_has_percent_encoded_bytes) != 0;
+  }
+  return result;
+}
+
+#if ADA_NEON || ADA_SSE2
+ada_really_inline uint8_t input_features(
+    std::string_view input, size_t& percent_encoded_bytes) noexcept {
+  percent_encoded_bytes = 0;
+  // first check for short strings in which case we do it naively.
+  if (input.size() < 16) {
+    return input_features_scalar(input, percent_encoded_bytes);
+  }
+  // Every comparison is masked with its feature bit and accumulated in a
+  // single register, the features of the input are the OR of its bytes. The
+  // last block overlaps the previous one, which is harmless for the features;
+  // the bytes it has in common with the previous block are not counted again.
+#if ADA_NEON
+  auto encoded = [](uint8x16_t word) -> uint8x16_t {
+    uint8x16_t result = vorrq_u8(vcleq_u8(word, vdupq_n_u8(' ')),
+                                 vcgeq_u8(word, vdupq_n_u8(0x7f)));
+    for (uint8_t c : {'"', '\'', '<', '>', '^', '`', '{', '}'}) {
+      result = vorrq_u8(result, vceqq_u8(word, vdupq_n_u8(c)));
+    }
+    return result;
+  };
+  auto features = [](uint8x16_t word) -> uint8x16_t {
+    auto match = [&word](uint8_t c, uint8_t bit) {
+      return vandq_u8(vceqq_u8(word, vdupq_n_u8(c)), vdupq_n_u8(bit));
+    };
+    uint8x16_t result =
+        vorrq_u8(vorrq_u8(match('\t', input_has_tabs_or_newline),
+                          match('\n', input_has_tabs_or_newline)),
+                 match('\r', input_has_tabs_or_newline));
+    return vorrq_u8(result, vorrq_u8(match('\\', input_has_backslash),
+                                     match('@', input_has_at_sign)));
+  };
+  // Adds the features of a block to running and returns the comparison
+  // result of its bytes that may be percent-encoded.
+  auto accumulate = [&](uint8x16_t& running, uint8x16_t word) -> uint8x16_t {
+    uint8x16_t to_encode = encoded(word);
+    running = vorrq_u8(
+        running,
+        vorrq_u8(features(word),
+                 vandq_u8(to_encode,
+                          vdupq_n_u8(input_has_percent_encoded_bytes))));
+    return to_encode;
+  };
+  // The number of lanes of a comparison result that are set.
+  auto count = [](uint8x16_t matches) -> size_t {
+    return vaddvq_u8(vshrq_n_u8(matches, 7));
+  };
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+  uint8x16_t running = vdupq_n_u8(0);
+  size_t i = 0;
+  for (; i + 15 < input.size(); i += 16) {
+    percent_encoded_bytes += count(accumulate(running, vld1q_u8(data + i)));
+  }
+  if (i < input.size()) {
+    // Loaded at input.size() - i, the lanes of the bytes not seen yet are set.
+    static const uint8_t new_lanes[32] = {
+        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+        0,    0,    0,    0,    0,    0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    uint8x16_t to_encode =
+        accumulate(running, vld1q_u8(data + input.size() - 16));
+    percent_encoded_bytes +=
+        count(vandq_u8(to_encode, vld1q_u8(new_lanes + input.size() - i)));
+  }
+  uint64_t folded = vgetq_lane_u64(vreinterpretq_u64_u8(running), 0) |
+                    vgetq_lane_u64(vreinterpretq_u64_u8(running), 1);
+#else
+  auto encoded = [](__m128i word) -> __m128i {
+    // A signed comparison: the bytes below '!' and the non-ASCII ones.
+    __m128i result = _mm_cmplt_epi8(word, _mm_set1_epi8('!'));
+    for (char c : {'"', '\'', '<', '>', '^', '`', '{', '}', '\x7f'}) {
+      result = _mm_or_si128(result, _mm_cmpeq_epi8(word, _mm_set1_epi8(c)));
+    }
+    return result;
+  };
+  auto features = [](__m128i word) -> __m128i {
+    auto match = [&word](char c, uint8_t bit) {
+      return _mm_and_si128(_mm_cmpeq_epi8(word, _mm_set1_epi8(c)),
+                           _mm_set1_epi8(char(bit)));
+    };
+    __m128i result =
+        _mm_or_si128(_mm_or_si128(match('\t', input_has_tabs_or_newline),
+                                  match('\n', input_has_tabs_or_newline)),
+                     match('\r', input_has_tabs_or_newline));
+    return _mm_or_si128(result, _mm_or_si128(match('\\', input_has_backslash),
+                                             match('@', input_has_at_sign)));
+  };
+  // Adds the features of a block to running and returns the bit mask of its
+  // bytes that may be percent-encoded.
+  auto accumulate = [&](__m128i& running, __m128i word) -> uint32_t {
+    __m128i to_encode = encoded(word);
+    running = _mm_or_si128(
+        running,
+        _mm_or_si128(features(word),
+                     _mm_and_si128(to_encode,
+                                   _mm_set1_epi8(char(
+                                       input_has_percent_encoded_bytes)))));
+    return uint32_t(_mm_movemask_epi8(to_encode));
+  };
+  __m128i running = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 15 < input.size(); i += 16) {
+    percent_encoded_bytes += std::popcount(accumulate(
+        running, _mm_loadu_si128((const __m128i*)(input.data() + i))));
+  }
+  if (i < input.size()) {
+    uint32_t to_encode = accumulate(
+        running,
+        _mm_loadu_si128((const __m128i*)(input.data() + input.size() - 16)));
+    // Bit j is lane j: the input.size() - i highest lanes are the new bytes.
+    percent_encoded_bytes +=
+        std::popcount(to_encode >> (16 - (input.size() - i)));
+  }
+  running = _mm_or_si128(running, _mm_srli_si128(running, 8));
+  uint64_t folded = uint32_t(_mm_cvtsi128_si32(running)) |
+                    (uint64_t(uint32_t(_mm_cvtsi128_si32(
+                         _mm_srli_si128(running, 4))))
+                     << 32);
+#endif
+  folded |= folded >> 32;
+  folded |= folded >> 16;
+  folded |= folded >> 8;
+  return uint8_t(folded);
+}
+#else
+ada_really_inline uint8_t input_features(
+    std::string_view input, size_t& percent_encoded_bytes) noexcept {
+  percent_encoded_bytes = 0;
+  return input_features_scalar(input, percent_encoded_bytes);
+}
+#endif
+
 // A forbidden host code point is U+0000 NULL, U+0009 TAB, U+000A LF, U+000D CR,
 // U+0020 SPACE, U+0023 (#), U+002F (/), U+003A (:), U+003C (<), U+003E (>),
 // U+003F (?), U+0040 (@), U+005B ([), U+005C (\), U+005D (]), U+005E (^), or
@@ -338,6 +503,176 @@ contains_forbidden_domain_code_point_or_upper(const char* input,
   return accumulator;
 }
 
+// Completes classify_host once the input has been lowered: the "xn--" label
+// check only runs when we saw an 'x', and the IPv4 hint only needs the last
+// significant character.
+ada_really_inline uint8_t finish_classify_host(const char* input,
+                                               size_t length, uint8_t result,
+                                               bool has_x) noexcept {
+  std::string_view view(input, length);
+  if (has_x) {
+    size_t label_start = 0;
+    while (label_start < view.size()) {
+      if (view.substr(label_start).starts_with("xn--")) {
+        result |= host_has_xn_label;
+        break;
+      }
+      size_t dot = view.find('.', label_start);
+      if (dot == std::string_view::npos) {
+        break;
+      }
+      label_start = dot + 1;
+    }
+  }
+  if (view.ends_with('.')) {
+    view.remove_suffix(1);
+  }
+  if (!view.empty()) {
+    char last = view.back();
+    if ((last >= '0' && last <= '9') || (last >= 'a' && last <= 'f') ||
+        last == 'x') {
+      result |= host_maybe_ipv4;
+    }
+  }
+  return result;
+}
+
+#if ADA_NEON
+ada_really_inline uint8_t classify_host(char* input, size_t length) noexcept {
+  uint64_t forbidden = 0;
+  uint64_t non_ascii = 0;
+  uint64_t upper = 0;
+  uint64_t has_x = 0;
+  // Narrowing by 4 bits turns each 0x00/0xFF byte into a nibble of a 64-bit
+  // mask, a cheap substitute for movemask.
+  auto to_mask = [](uint8x16_t v) -> uint64_t {
+    return vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+  };
+  for (size_t i = 0; i < length; i += 16) {
+    const size_t n = std::min<size_t>(16, length - i);
+    uint8_t tmp[16] = {};
+    uint8x16_t word;
+    if (n == 16) {
+      word = vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+    } else {
+      memcpy(tmp, input + i, n);
+      word = vld1q_u8(tmp);
+    }
+    uint8x16_t is_forbidden = vorrq_u8(vcleq_u8(word, vdupq_n_u8(0x20)),
+                                       vceqq_u8(word, vdupq_n_u8(0x7f)));
+    for (uint8_t c : {'#', '%', '/', ':', '<', '>', '?', '@', '[', '\\', ']',
+                      '^', '|'}) {
+      is_forbidden = vorrq_u8(is_forbidden, vceqq_u8(word, vdupq_n_u8(c)));
+    }
+    uint8x16_t is_upper =
+        vcleq_u8(vsubq_u8(word, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+    uint8x16_t lowered =
+        vorrq_u8(word, vandq_u8(is_upper, vdupq_n_u8(0x20)));
+    const uint64_t valid = n == 16 ? ~uint64_t(0) : (uint64_t(1) << (4 * n)) - 1;
+    forbidden |= to_mask(is_forbidden) & valid;
+    non_ascii |= to_mask(vcgeq_u8(word, vdupq_n_u8(0x80))) & valid;
+    upper |= to_mask(is_upper) & valid;
+    has_x |= to_mask(vceqq_u8(lowered, vdupq_n_u8('x'))) & valid;
+    if (n == 16) {
+      vst1q_u8(reinterpret_cast<uint8_t*>(input + i), lowered);
+    } else {
+      vst1q_u8(tmp, lowered);
+      memcpy(input + i, tmp, n);
+    }
+  }
+  uint8_t result = uint8_t((forbidden ? host_forbidden : 0) |
+                           (non_ascii ? host_non_ascii : 0) |
+                           (upper ? host_has_upper : 0));
+  return finish_classify_host(input, length, result, has_x != 0);
+}
+#elif ADA_SSE2
+ada_really_inline uint8_t classify_host(char* input, size_t length) noexcept {
+  int forbidden = 0;
+  int non_ascii = 0;
+  int upper = 0;
+  int has_x = 0;
+  const __m128i c20 = _mm_set1_epi8(0x20);
+  for (size_t i = 0; i < length; i += 16) {
+    const size_t n = std::min<size_t>(16, length - i);
+    alignas(16) char tmp[16] = {};
+    __m128i word;
+    if (n == 16) {
+      word = _mm_loadu_si128((const __m128i*)(input + i));
+    } else {
+      memcpy(tmp, input + i, n);
+      word = _mm_load_si128((const __m128i*)tmp);
+    }
+    // Unsigned comparison: word <= 0x20.
+    __m128i is_forbidden =
+        _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(word, c20), word),
+                     _mm_cmpeq_epi8(word, _mm_set1_epi8(0x7f)));
+    for (char c : {'#', '%', '/', ':', '<', '>', '?', '@', '[', '\\', ']', '^',
+                   '|'}) {
+      is_forbidden =
+          _mm_or_si128(is_forbidden, _mm_cmpeq_epi8(word, _mm_set1_epi8(c)));
+    }
+    // 'A'..'Z' is moved to the bottom of the signed range.
+    __m128i is_upper =
+        _mm_cmplt_epi8(_mm_add_epi8(word, _mm_set1_epi8(char(0x80 - 'A'))),
+                       _mm_set1_epi8(char(0x80 + 26)));
+    __m128i lowered = _mm_or_si128(word, _mm_and_si128(is_upper, c20));
+    const int valid = n == 16 ? 0xFFFF : (1 << n) - 1;
+    forbidden |= _mm_movemask_epi8(is_forbidden) & valid;
+    non_ascii |= _mm_movemask_epi8(word) & valid;
+    upper |= _mm_movemask_epi8(is_upper) & valid;
+    has_x |=
+        _mm_movemask_epi8(_mm_cmpeq_epi8(lowered, _mm_set1_epi8('x'))) & valid;
+    if (n == 16) {
+      _mm_storeu_si128((__m128i*)(input + i), lowered);
+    } else {
+      _mm_store_si128((__m128i*)tmp, lowered);
+      memcpy(input + i, tmp, n);
+    }
+  }
+  uint8_t result = uint8_t((forbidden ? host_forbidden : 0) |
+                           (non_ascii ? host_non_ascii : 0) |
+                           (upper ? host_has_upper : 0));
+  return finish_classify_host(input, length, result, has_x != 0);
+}
+#else
+// Used by classify_host: the bits are host_forbidden, host_non_ascii and
+// host_has_upper.
+constexpr static std::array<uint8_t, 256> host_class_table = []() consteval {
+  std::array<uint8_t, 256> result{};
+  for (uint8_t c : {'#', '%', '/', ':', '<', '>', '?', '@', '[', '\\', ']', '^',
+                    '|'}) {
+    result[c] = host_forbidden;
+  }
+  for (uint8_t c = 0; c <= 32; c++) {
+    result[c] = host_forbidden;
+  }
+  result[127] = host_forbidden;
+  for (size_t c = 128; c < 256; c++) {
+    result[c] = host_non_ascii;
+  }
+  for (uint8_t c = 'A'; c <= 'Z'; c++) {
+    result[c] = host_has_upper;
+  }
+  return result;
+}();
+
+ada_really_inline uint8_t classify_host(char* input, size_t length) noexcept {
+  uint8_t result = 0;
+  bool has_x = false;
+  for (size_t i = 0; i < length; i++) {
+    const uint8_t c = uint8_t(input[i]);
+    const uint8_t class_bits = host_class_table[c];
+    result |= class_bits;
+    // host_has_upper is 4: shifting it by 3 gives the 0x20 case bit.
+    const char lowered = char(c | ((class_bits & host_has_upper) << 3));
+    has_x |= (lowered == 'x');
+    input[i] = lowered;
+  }
+  return finish_classify_host(input, length, result, has_x);
+}
+#endif
+
 // std::isalnum(c) || c == '+' || c == '-' || c == '.') is true for
 constexpr static std::array<bool, 256> is_alnum_plus_table = []() consteval {
   std::array<bool, 256> result{};
@@ -455,11 +790,17 @@ std::string percent_decode(const std::string_view input, size_t first_percent) {
   if (first_percent == std::string_view::npos) {
     return std::string(input);
   }
-  std::string dest;
-  dest.reserve(input.length());
-  dest.append(input.substr(0, first_percent));
-  const char* pointer = input.data() + first_percent;
-  const char* end = input.data() + input.size();
+  std::string dest(input);
+  dest.resize(percent_decode_in_place(dest.data(), dest.size(), first_percent));
+  return dest;
+}
+
+size_t percent_decode_in_place(char* input, size_t length,
+                               size_t first_percent) noexcept {
+  // The write position never gets ahead of the read position.
+  char* out = input + first_percent;
+  const char* pointer = out;
+  const char* end = input + length;
   // Optimization opportunity: if the following code gets
   // called often, it can be optimized quite a bit.
   while (pointer < end) {
@@ -469,17 +810,16 @@ std::string percent_decode(const std::string_view input, size_t first_percent) {
         (  // ch == '%' && // It is unnecessary to check that ch == '%'.
             (!is_ascii_hex_digit(pointer[1]) ||
              !is_ascii_hex_digit(pointer[2])))) {
-      dest += ch;
+      *out++ = ch;
       pointer++;
     } else {
       unsigned a = convert_hex_to_binary(pointer[1]);
       unsigned b = convert_hex_to_binary(pointer[2]);
-      char c = static_cast<char>(a * 16 + b);
-      dest += c;
+      *out++ = static_cast<char>(a * 16 + b);
       pointer += 3;
     }
   }
-  return dest;
+  return size_t(out - input);
 }
 
 std::string percent_encode(const std::string_view input,
@@ -543,22 +883,73 @@ bool percent_encode(const std::string_view input, const uint8_t character_set[],
   return true;
 }
 
-bool to_ascii(std::optional<std::string>& out, const std::string_view plain,
+namespace {
+// Scratch space for the hosts that go through IDNA. It is kept per thread so
+// that converting hosts does not allocate once its buffers have grown to fit
+// them. A buffer that a pathological input grew past max_retained_scratch is
+// released on the next call.
+struct to_ascii_scratch {
+  ada::idna::scratch_buffers idna{};
+  std::string decoded{};
+  std::string ascii{};
+};
+
+constexpr size_t max_retained_scratch = 1024;
+
+to_ascii_scratch& get_to_ascii_scratch() {
+  static thread_local to_ascii_scratch scratch;
+  return scratch;
+}
+
+template <class string_type>
+void release_if_large(string_type& buffer) {
+  if (buffer.capacity() > max_retained_scratch) {
+    string_type().swap(buffer);
+  }
+}
+
+void release_large_buffers(to_ascii_scratch& scratch) {
+  release_if_large(scratch.idna.utf32);
+  release_if_large(scratch.idna.mapped);
+  release_if_large(scratch.idna.tmp_buffer);
+  release_if_large(scratch.idna.post_map);
+  release_if_large(scratch.decoded);
+  release_if_large(scratch.ascii);
+}
+}  // namespace
+
+bool to_ascii(std::string& out, const std::string_view plain,
               size_t first_percent) {
-  std::string percent_decoded_buffer;
+  to_ascii_scratch& scratch = get_to_ascii_scratch();
+  release_large_buffers(scratch);
   std::string_view input = plain;
   if (first_percent != std::string_view::npos) {
-    percent_decoded_buffer = unicode::percent_decode(plain, first_percent);
-    input = percent_decoded_buffer;
+    scratch.decoded.assign(plain);
+    scratch.decoded.resize(percent_decode_in_place(
+        scratch.decoded.data(), scratch.decoded.size(), first_percent));
+    // A percent-encoded ASCII domain without punycode labels only needs to be
+    // lowered: the decoded string is the result and IDNA is not needed.
+    const uint8_t host_class =
+        classify_host(scratch.decoded.data(), scratch.decoded.size());
+    if ((host_class & (host_non_ascii | host_has_xn_label)) == 0) {
+      out.assign(scratch.decoded);
+      return (host_class & host_forbidden) == 0;
+    }
+    input = scratch.decoded;
   }
   // input is a non-empty UTF-8 string, must be percent decoded
-  std::string idna_ascii = ada::idna::to_ascii(input);
-  if (idna_ascii.empty() || contains_forbidden_domain_code_point(
-                                idna_ascii.data(), idna_ascii.size())) {
-    return false;
+  out.clear();
+  return ada::idna::to_ascii(input, out, scratch.idna) && !out.empty() &&
+         !contains_forbidden_domain_code_point(out.data(), out.size());
+}
+
+std::optional<std::string_view> to_ascii(const std::string_view plain,
+                                         size_t first_percent) {
+  std::string& ascii = get_to_ascii_scratch().ascii;
+  if (!to_ascii(ascii, plain, first_percent)) {
+    return std::nullopt;
   }
-  out = std::move(idna_ascii);
-  return true;
+  return ascii;
 }
 
 std::string percent_encode(const std::string_view input,
@@ -577,4 +968,30 @@ std::string percent_encode(const std::string_view input,
   return out;
 }
 
+size_t percent_encode_in_place(std::string& out, size_t start, size_t length,
+                               const uint8_t character_set[]) {
+  size_t encoded = 0;
+  for (size_t i = start; i < start + length; i++) {
+    encoded += character_sets::bit_at(character_set, out[i]);
+  }
+  if (encoded == 0) {
+    return 0;
+  }
+  const size_t growth = 2 * encoded;
+  out.insert(start + length, growth, '\0');
+  // Walk backward so that every byte is read before it gets overwritten.
+  char* data = out.data();
+  size_t destination = start + length + growth;
+  for (size_t i = start + length; i-- > start;) {
+    const char c = data[i];
+    if (character_sets::bit_at(character_set, c)) {
+      destination -= 3;
+      std::memcpy(data + destination, character_sets::hex + uint8_t(c) * 4, 3);
+    } else {
+      data[--destination] = c;
+    }
+  }
+  return growth;
+}
+
 }  // namespace ada::unicode
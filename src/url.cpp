@@ -12,6 +12,38 @@
 
 namespace ada {
 
+url::url(const url_aggregator& u) {
+  ada_log("url::url(const url_aggregator&) ", u.get_href());
+  is_valid = u.is_valid;
+  has_opaque_path = u.has_opaque_path;
+  host_type = u.host_type;
+  type = u.type;
+  const url_components& components = u.get_components();
+  const std::string_view href = u.get_href();
+  if (!is_special()) {
+    non_special_scheme = href.substr(0, components.protocol_end - 1);
+  }
+  if (u.has_hostname()) {
+    username = u.get_username();
+    password = u.get_password();
+    host = u.get_hostname();
+  }
+  if (components.port != url_components::omitted) {
+    port = uint16_t(components.port);
+  }
+  path = u.get_pathname();
+  if (components.search_start != url_components::omitted) {
+    size_t search_end = components.hash_start != url_components::omitted
+                            ? components.hash_start
+                            : href.size();
+    query = href.substr(components.search_start + 1,
+                        search_end - components.search_start - 1);
+  }
+  if (components.hash_start != url_components::omitted) {
+    hash = href.substr(components.hash_start + 1);
+  }
+}
+
 bool url::parse_opaque_host(std::string_view input) {
   ada_log("parse_opaque_host ", input, " [", input.size(), " bytes]");
   if (std::ranges::any_of(input, ada::unicode::is_forbidden_host_code_point)) {
@@ -102,226 +134,8 @@ final:
 
 bool url::parse_ipv6(std::string_view input) {
   ada_log("parse_ipv6 ", input, " [", input.size(), " bytes]");
-
-  if (input.empty()) {
-    return is_valid = false;
-  }
-  // Let address be a new IPv6 address whose IPv6 pieces are all 0.
   std::array<uint16_t, 8> address{};
-
-  // Let pieceIndex be 0.
-  int piece_index = 0;
-
-  // Let compress be null.
-  std::optional<int> compress{};
-
-  // Let pointer be a pointer for input.
-  std::string_view::iterator pointer = input.begin();
-
-  // If c is U+003A (:), then:
-  if (input[0] == ':') {
-    // If remaining does not start with U+003A (:), validation error, return
-    // failure.
-    if (input.size() == 1 || input[1] != ':') {
-      ada_log("parse_ipv6 starts with : but the rest does not start with :");
-      return is_valid = false;
-    }
-
-    // Increase pointer by 2.
-    pointer += 2;
-
-    // Increase pieceIndex by 1 and then set compress to pieceIndex.
-    compress = ++piece_index;
-  }
-
-  // While c is not the EOF code point:
-  while (pointer != input.end()) {
-    // If pieceIndex is 8, validation error, return failure.
-    if (piece_index == 8) {
-      ada_log("parse_ipv6 piece_index == 8");
-      return is_valid = false;
-    }
-
-    // If c is U+003A (:), then:
-    if (*pointer == ':') {
-      // If compress is non-null, validation error, return failure.
-      if (compress.has_value()) {
-        ada_log("parse_ipv6 compress is non-null");
-        return is_valid = false;
-      }
-
-      // Increase pointer and pieceIndex by 1, set compress to pieceIndex, and
-      // then continue.
-      pointer++;
-      compress = ++piece_index;
-      continue;
-    }
-
-    // Let value and length be 0.
-    uint16_t value = 0, length = 0;
-
-    // While length is less than 4 and c is an ASCII hex digit,
-    // set value to value times 0x10 + c interpreted as hexadecimal number, and
-    // increase pointer and length by 1.
-    while (length < 4 && pointer != input.end() &&
-           unicode::is_ascii_hex_digit(*pointer)) {
-      // https://stackoverflow.com/questions/39060852/why-does-the-addition-of-two-shorts-return-an-int
-      value = uint16_t(value * 0x10 + unicode::convert_hex_to_binary(*pointer));
-      pointer++;
-      length++;
-    }
-
-    // If c is U+002E (.), then:
-    if (pointer != input.end() && *pointer == '.') {
-      // If length is 0, validation error, return failure.
-      if (length == 0) {
-        ada_log("parse_ipv6 length is 0");
-        return is_valid = false;
-      }
-
-      // Decrease pointer by length.
-      pointer -= length;
-
-      // If pieceIndex is greater than 6, validation error, return failure.
-      if (piece_index > 6) {
-        ada_log("parse_ipv6 piece_index > 6");
-        return is_valid = false;
-      }
-
-      // Let numbersSeen be 0.
-      int numbers_seen = 0;
-
-      // While c is not the EOF code point:
-      while (pointer != input.end()) {
-        // Let ipv4Piece be null.
-        std::optional<uint16_t> ipv4_piece{};
-
-        // If numbersSeen is greater than 0, then:
-        if (numbers_seen > 0) {
-          // If c is a U+002E (.) and numbersSeen is less than 4, then increase
-          // pointer by 1.
-          if (*pointer == '.' && numbers_seen < 4) {
-            pointer++;
-          }
-          // Otherwise, validation error, return failure.
-          else {
-            ada_log("parse_ipv6 Otherwise, validation error, return failure");
-            return is_valid = false;
-          }
-        }
-
-        // If c is not an ASCII digit, validation error, return failure.
-        if (pointer == input.end() || !checkers::is_digit(*pointer)) {
-          ada_log(
-              "parse_ipv6 If c is not an ASCII digit, validation error, return "
-              "failure");
-          return is_valid = false;
-        }
-
-        // While c is an ASCII digit:
-        while (pointer != input.end() && checkers::is_digit(*pointer)) {
-          // Let number be c interpreted as decimal number.
-          int number = *pointer - '0';
-
-          // If ipv4Piece is null, then set ipv4Piece to number.
-          if (!ipv4_piece.has_value()) {
-            ipv4_piece = number;
-          }
-          // Otherwise, if ipv4Piece is 0, validation error, return failure.
-          else if (ipv4_piece == 0) {
-            ada_log("parse_ipv6 if ipv4Piece is 0, validation error");
-            return is_valid = false;
-          }
-          // Otherwise, set ipv4Piece to ipv4Piece times 10 + number.
-          else {
-            ipv4_piece = *ipv4_piece * 10 + number;
-          }
-
-          // If ipv4Piece is greater than 255, validation error, return failure.
-          if (ipv4_piece > 255) {
-            ada_log("parse_ipv6 ipv4_piece > 255");
-            return is_valid = false;
-          }
-
-          // Increase pointer by 1.
-          pointer++;
-        }
-
-        // Set address[pieceIndex] to address[pieceIndex] times 0x100 +
-        // ipv4Piece.
-        // https://stackoverflow.com/questions/39060852/why-does-the-addition-of-two-shorts-return-an-int
-        address[piece_index] =
-            uint16_t(address[piece_index] * 0x100 + *ipv4_piece);
-
-        // Increase numbersSeen by 1.
-        numbers_seen++;
-
-        // If numbersSeen is 2 or 4, then increase pieceIndex by 1.
-        if (numbers_seen == 2 || numbers_seen == 4) {
-          piece_index++;
-        }
-      }
-
-      // If numbersSeen is not 4, validation error, return failure.
-      if (numbers_seen != 4) {
-        return is_valid = false;
-      }
-
-      // Break.
-      break;
-    }
-    // Otherwise, if c is U+003A (:):
-    else if ((pointer != input.end()) && (*pointer == ':')) {
-      // Increase pointer by 1.
-      pointer++;
-
-      // If c is the EOF code point, validation error, return failure.
-      if (pointer == input.end()) {
-        ada_log(
-            "parse_ipv6 If c is the EOF code point, validation error, return "
-            "failure");
-        return is_valid = false;
-      }
-    }
-    // Otherwise, if c is not the EOF code point, validation error, return
-    // failure.
-    else if (pointer != input.end()) {
-      ada_log(
-          "parse_ipv6 Otherwise, if c is not the EOF code point, validation "
-          "error, return failure");
-      return is_valid = false;
-    }
-
-    // Set address[pieceIndex] to value.
-    address[piece_index] = value;
-
-    // Increase pieceIndex by 1.
-    piece_index++;
-  }
-
-  // If compress is non-null, then:
-  if (compress.has_value()) {
-    // Let swaps be pieceIndex - compress.
-    int swaps = piece_index - *compress;
-
-    // Set pieceIndex to 7.
-    piece_index = 7;
-
-    // While pieceIndex is not 0 and swaps is greater than 0,
-    // swap address[pieceIndex] with address[compress + swaps - 1], and then
-    // decrease both pieceIndex and swaps by 1.
-    while (piece_index != 0 && swaps > 0) {
-      std::swap(address[piece_index], address[*compress + swaps - 1]);
-      piece_index--;
-      swaps--;
-    }
-  }
-  // Otherwise, if compress is null and pieceIndex is not 8, validation error,
-  // return failure.
-  else if (piece_index != 8) {
-    ada_log(
-        "parse_ipv6 if compress is null and pieceIndex is not 8, validation "
-        "error, return failure");
+  if (!checkers::parse_ipv6(input, address)) {
     return is_valid = false;
   }
   host = ada::serializers::ipv6(address);
@@ -424,7 +238,8 @@ ada_really_inline bool url::parse_scheme(const std::string_view input) {
   return true;
 }
 
-ada_really_inline bool url::parse_host(std::string_view input) {
+ada_really_inline bool url::parse_host(std::string_view input,
+                                       const parse_options* options) {
   ada_log("parse_host ", input, " [", input.size(), " bytes]");
   if (input.empty()) {
     return is_valid = false;
@@ -450,38 +265,65 @@ ada_really_inline bool url::parse_host(std::string_view input) {
     return parse_opaque_host(input);
   }
 
-  // Fast path: try to parse as pure decimal IPv4(a.b.c.d) first.
+  // With dotted_decimal_ipv4_only, a host that ends in a number is only
+  // accepted in the dotted-decimal form that the fast path below recognizes
+  // as canonical: the other number forms are never parsed. A host that only
+  // takes that form once percent-decoded or mapped by IDNA (e.g.,
+  // "%31%32%37.0.0.1" or fullwidth digits) is accepted as well.
+  const bool dotted_decimal_ipv4_only =
+      options != nullptr && options->dotted_decimal_ipv4_only;
+  auto is_dotted_decimal = [](std::string_view hostname) {
+    return (checkers::try_parse_ipv4_fast(hostname) &
+            (checkers::ipv4_fast_fail | checkers::ipv4_fast_reserialize)) == 0;
+  };
+
+  // Fast path: try to parse as an IPv4 address (a.b.c.d, 0x7f.1, ...) first.
   const uint64_t fast_result = checkers::try_parse_ipv4_fast(input);
-  if (fast_result < checkers::ipv4_fast_fail) {
-    // Fast path succeeded - input is pure decimal IPv4
-    if (!input.empty() && input.back() == '.') {
+  if ((fast_result & checkers::ipv4_fast_fail) == 0) {
+    if (fast_result & checkers::ipv4_fast_reserialize) {
+      if (dotted_decimal_ipv4_only) {
+        return is_valid = false;
+      }
+      // Hexadecimal, octal or short form: we have to reserialize it.
+      host = ada::serializers::ipv4(uint32_t(fast_result & 0xFFFFFFFF));
+    } else if (input.back() == '.') {
       host = input.substr(0, input.size() - 1);
     } else {
       host = input;
     }
     host_type = IPV4;
     is_valid = true;
-    ada_log("parse_host fast path decimal ipv4");
+    ada_log("parse_host fast path ipv4");
     return true;
   }
   // Let domain be the result of running UTF-8 decode without BOM on the
   // percent-decoding of input. Let asciiDomain be the result of running domain
   // to ASCII with domain and false. The most common case is an ASCII input, in
-  // which case we do not need to call the expensive 'to_ascii' if a few
-  // conditions are met: no '%' and no 'xn-' subsequence.
+  // which case we do not need to call the expensive 'to_ascii': classify_host
+  // tells us whether the host has a forbidden code point (including '%'), a
+  // non-ASCII byte or a label that starts with "xn--" (in any case).
   std::string buffer = std::string(input);
-  // This next function checks that the result is ascii, but we are going to
-  // to check anyhow with is_forbidden.
-  // bool is_ascii =
-  unicode::to_lower_ascii(buffer.data(), buffer.size());
-  bool is_forbidden = unicode::contains_forbidden_domain_code_point(
-      buffer.data(), buffer.size());
-  if (is_forbidden == 0 && buffer.find("xn-") == std::string_view::npos) {
+  const uint8_t host_class =
+      unicode::classify_host(buffer.data(), buffer.size());
+  const size_t first_percent = (host_class & unicode::host_forbidden)
+                                   ? input.find('%')
+                                   : std::string_view::npos;
+  if (options != nullptr && options->reject_non_ascii_hosts &&
+      ((host_class & unicode::host_non_ascii) ||
+       first_percent != std::string_view::npos)) {
+    return is_valid = false;
+  }
+  if ((host_class & (unicode::host_forbidden | unicode::host_non_ascii |
+                     unicode::host_has_xn_label)) == 0) {
     // fast path
     host = std::move(buffer);
 
     // Check for other IPv4 formats (hex, octal, etc.)
-    if (checkers::is_ipv4(host.value())) {
+    if ((host_class & unicode::host_maybe_ipv4) &&
+        checkers::is_ipv4(host.value())) {
+      if (dotted_decimal_ipv4_only && !is_dotted_decimal(*host)) {
+        return is_valid = false;
+      }
       ada_log("parse_host fast path ipv4");
       return parse_ipv4(host.value());
     }
@@ -490,11 +332,12 @@ ada_really_inline bool url::parse_host(std::string_view input) {
     return true;
   }
   ada_log("parse_host calling to_ascii");
-  is_valid = ada::unicode::to_ascii(host, input, input.find('%'));
-  if (!is_valid || !host.has_value()) {
+  is_valid = ada::unicode::to_ascii(buffer, input, first_percent);
+  if (!is_valid) {
     ada_log("parse_host to_ascii returns false");
     return is_valid = false;
   }
+  host = std::move(buffer);
   ada_log("parse_host to_ascii succeeded ", *host, " [", host->size(),
           " bytes]");
 
@@ -507,6 +350,9 @@ ada_really_inline bool url::parse_host(std::string_view input) {
   // If asciiDomain ends in a number, then return the result of IPv4 parsing
   // asciiDomain.
   if (checkers::is_ipv4(*host)) {
+    if (dotted_decimal_ipv4_only && !is_dotted_decimal(*host)) {
+      return is_valid = false;
+    }
     ada_log("parse_host got ipv4 ", *host);
     return parse_ipv4(*host);
   }
@@ -613,7 +459,16 @@ ada_really_inline void url::parse_path(std::string_view input) {
     if (type == scheme::FILE) {
       return "null";
     }
-    return ada::helpers::concat(get_protocol(), "//", get_host());
+    std::string origin;
+    // The scheme, "://", the host and at most six bytes for the port.
+    origin.reserve(ada::scheme::details::is_special_list[type].size() + 3 +
+                   (host.has_value() ? host->size() : 0) + 6);
+    append_protocol(origin);
+    origin += "//";
+    if (host.has_value()) {
+      append_host(origin);
+    }
+    return origin;
   }
 
   if (non_special_scheme == "blob") {
@@ -623,8 +478,14 @@ ada_really_inline void url::parse_path(std::string_view input) {
           (result->type == scheme::HTTP || result->type == scheme::HTTPS)) {
         // If pathURL's scheme is not "http" and not "https", then return a
         // new opaque origin.
-        return ada::helpers::concat(result->get_protocol(), "//",
-                                    result->get_host());
+        std::string origin;
+        origin.reserve(result->get_href_size());
+        result->append_protocol(origin);
+        origin += "//";
+        if (result->host.has_value()) {
+          result->append_host(origin);
+        }
+        return origin;
       }
     }
   }
@@ -634,11 +495,13 @@ ada_really_inline void url::parse_path(std::string_view input) {
 }
 
 [[nodiscard]] std::string url::get_protocol() const {
-  if (is_special()) {
-    return helpers::concat(ada::scheme::details::is_special_list[type], ":");
-  }
-  // We only move the 'scheme' if it is non-special.
-  return helpers::concat(non_special_scheme, ":");
+  std::string output;
+  output.reserve(
+      (is_special() ? ada::scheme::details::is_special_list[type].size()
+                    : non_special_scheme.size()) +
+      1);
+  append_protocol(output);
+  return output;
 }
 
 [[nodiscard]] std::string url::get_host() const {
@@ -649,20 +512,54 @@ ada_really_inline void url::parse_path(std::string_view input) {
   if (!host.has_value()) {
     return "";
   }
-  if (port.has_value()) {
-    return host.value() + ":" + get_port();
+  if (!port.has_value()) {
+    return host.value();
   }
-  return host.value();
+  std::string output;
+  output.reserve(host->size() + 6);  // ":" and at most five digits
+  append_host(output);
+  return output;
 }
 
 [[nodiscard]] std::string url::get_hostname() const {
   return host.value_or("");
 }
 
+[[nodiscard]] std::optional<uint32_t> url::get_ipv4_address() const noexcept {
+  if (host_type != url_host_type::IPV4 || !host.has_value()) {
+    return std::nullopt;
+  }
+  // The host is the canonical dotted-decimal serialization.
+  const uint64_t address = checkers::try_parse_ipv4_fast(*host);
+  if (address & checkers::ipv4_fast_fail) {
+    return std::nullopt;
+  }
+  return uint32_t(address & 0xFFFFFFFF);
+}
+
+[[nodiscard]] std::optional<std::array<uint16_t, 8>> url::get_ipv6_address()
+    const noexcept {
+  if (host_type != url_host_type::IPV6 || !host.has_value()) {
+    return std::nullopt;
+  }
+  std::array<uint16_t, 8> address{};
+  if (!checkers::parse_serialized_ipv6(*host, address)) {
+    return std::nullopt;
+  }
+  return address;
+}
+
 [[nodiscard]] std::string url::get_search() const {
   // If this's URL's query is either null or the empty string, then return the
   // empty string. Return U+003F (?), followed by this's URL's query.
-  return (!query.has_value() || (query->empty())) ? "" : "?" + query.value();
+  if (!query.has_value() || query->empty()) {
+    return "";
+  }
+  std::string output;
+  output.reserve(1 + query->size());
+  output += '?';
+  output += *query;
+  return output;
 }
 
 [[nodiscard]] const std::string& url::get_username() const noexcept {
@@ -680,7 +577,14 @@ ada_really_inline void url::parse_path(std::string_view input) {
 [[nodiscard]] std::string url::get_hash() const {
   // If this's URL's fragment is either null or the empty string, then return
   // the empty string. Return U+0023 (#), followed by this's URL's fragment.
-  return (!hash.has_value() || (hash->empty())) ? "" : "#" + hash.value();
+  if (!hash.has_value() || hash->empty()) {
+    return "";
+  }
+  std::string output;
+  output.reserve(1 + hash->size());
+  output += '#';
+  output += *hash;
+  return output;
 }
 
 template <bool override_hostname>
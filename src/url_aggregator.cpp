@@ -1,6 +1,7 @@
 #include "ada/checkers-inl.h"
 #include "ada/helpers.h"
 #include "ada/implementation.h"
+#include "ada/query_filter.h"
 #include "ada/scheme.h"
 #include "ada/unicode-inl.h"
 #include "ada/url_components.h"
@@ -8,10 +9,14 @@
 #include "ada/url_aggregator.h"
 #include "ada/url_aggregator-inl.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iterator>
 #include <ranges>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace {
 
@@ -29,9 +34,74 @@ ada_really_inline void apply_shifted_non_scheme_offsets(
   }
 }
 
+// Uppercases the hex digits of the percent-escapes in [data, data + length).
+void uppercase_percent_escapes(char* data, size_t length) noexcept {
+  char* end = data + length;
+  char* percent = data;
+  while ((percent = static_cast<char*>(
+              std::memchr(percent, '%', size_t(end - percent)))) != nullptr) {
+    if (end - percent < 3) {
+      return;
+    }
+    if (ada::unicode::is_ascii_hex_digit(percent[1]) &&
+        ada::unicode::is_ascii_hex_digit(percent[2])) {
+      // Clearing bit 5 maps 'a'-'f' to 'A'-'F'.
+      for (char* digit : {percent + 1, percent + 2}) {
+        if (*digit >= 'a') {
+          *digit = char(*digit & ~0x20);
+        }
+      }
+    }
+    percent++;
+  }
+}
+
 }  // namespace
 
 namespace ada {
+
+url_aggregator::url_aggregator(const url& u) : buffer(u.get_href()) {
+  ada_log("url_aggregator::url_aggregator(const url&) ", buffer);
+  is_valid = u.is_valid;
+  has_opaque_path = u.has_opaque_path;
+  host_type = u.host_type;
+  type = u.type;
+  // A scheme never contains a colon, so the first one ends the protocol.
+  components.protocol_end = uint32_t(buffer.find(':') + 1);
+  uint32_t running_index = components.protocol_end;
+  components.username_end = running_index;
+  components.host_start = running_index;
+  if (u.host.has_value()) {
+    running_index += 2;  // "//"
+    components.username_end = running_index + uint32_t(u.username.size());
+    components.host_start = components.username_end;
+    if (!u.password.empty()) {
+      components.host_start += 1 + uint32_t(u.password.size());
+    }
+    // When there are credentials, host_start points at the '@'.
+    running_index = components.host_start + uint32_t(u.has_credentials()) +
+                    uint32_t(u.host->size());
+  } else if (!u.has_opaque_path && u.path.starts_with("//")) {
+    running_index += 2;  // "/."
+  }
+  components.host_end = u.host.has_value() ? running_index
+                                           : components.host_start;
+  if (u.port.has_value()) {
+    components.port = *u.port;
+    running_index += 1 + helpers::fast_digit_count(*u.port);
+  }
+  components.pathname_start = running_index;
+  running_index += uint32_t(u.path.size());
+  if (u.query.has_value()) {
+    components.search_start = running_index;
+    running_index += 1 + uint32_t(u.query->size());
+  }
+  if (u.hash.has_value()) {
+    components.hash_start = running_index;
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
 template <bool has_state_override>
 [[nodiscard]] ada_really_inline bool url_aggregator::parse_scheme_with_colon(
     const std::string_view input_with_colon) {
@@ -82,6 +152,13 @@ template <bool has_state_override>
         clear_port();
       }
     }
+  } else if constexpr (!has_state_override) {
+    // Copy the scheme and lower it where it lands in the buffer, without a
+    // temporary string. Upper case letters may still spell a special scheme.
+    set_scheme_from_view_with_colon(input_with_colon);
+    unicode::to_lower_ascii(buffer.data(), input.size());
+    type = ada::scheme::get_scheme_type(
+        std::string_view(buffer.data(), input.size()));
   } else {  // slow path
     std::string _buffer(input);
     // Next function is only valid if the input is ASCII and returns false
@@ -447,6 +524,162 @@ void url_aggregator::set_hash(const std::string_view input) {
   ADA_ASSERT_TRUE(validate());
 }
 
+void url_aggregator::canonicalize_for_cache(const query_filter* filter) {
+  ada_log("url_aggregator::canonicalize_for_cache ", buffer);
+  ADA_ASSERT_TRUE(validate());
+  if (components.hash_start != url_components::omitted) {
+    buffer.resize(components.hash_start);
+    components.hash_start = url_components::omitted;
+  }
+  const uint32_t path_end = components.search_start != url_components::omitted
+                                ? components.search_start
+                                : uint32_t(buffer.size());
+  uppercase_percent_escapes(buffer.data() + components.pathname_start,
+                            path_end - components.pathname_start);
+  if (components.search_start == url_components::omitted) {
+    helpers::strip_trailing_spaces_from_opaque_path(*this);
+    return;
+  }
+  const uint32_t query_start = components.search_start + 1;
+  const uint32_t query_length = uint32_t(buffer.size()) - query_start;
+  char* query = buffer.data() + query_start;
+  uppercase_percent_escapes(query, query_length);
+
+  struct parameter {
+    uint32_t start;
+    uint32_t length;
+    uint32_t key_length;
+  };
+  // Most queries have few parameters, we only go to the heap for long ones.
+  const size_t max_parameters =
+      size_t(std::count(query, query + query_length, '&')) + 1;
+  std::array<parameter, 32> stack_parameters;
+  std::vector<parameter> heap_parameters;
+  parameter* parameters = stack_parameters.data();
+  if (max_parameters > stack_parameters.size()) {
+    heap_parameters.resize(max_parameters);
+    parameters = heap_parameters.data();
+  }
+  size_t count = 0;
+  bool dropped = false;
+  for (uint32_t start = 0; start <= query_length;) {
+    const char* ampersand = static_cast<const char*>(
+        std::memchr(query + start, '&', query_length - start));
+    const uint32_t end =
+        ampersand ? uint32_t(ampersand - query) : query_length;
+    const std::string_view pair(query + start, end - start);
+    const uint32_t key_length = uint32_t(std::min(pair.find('='), pair.size()));
+    if (pair.empty() ||
+        (filter && filter->contains(pair.substr(0, key_length)))) {
+      dropped = true;
+    } else {
+      parameters[count++] = {start, end - start, key_length};
+    }
+    start = end + 1;
+  }
+  auto key = [query](const parameter& p) {
+    return std::string_view(query + p.start, p.key_length);
+  };
+  auto less = [&key](const parameter& a, const parameter& b) {
+    return key(a) < key(b);
+  };
+  bool sorted = std::is_sorted(parameters, parameters + count, less);
+  if (!dropped && sorted) {
+    ADA_ASSERT_TRUE(validate());
+    return;
+  }
+  if (count == 0) {
+    buffer.resize(components.search_start);
+    components.search_start = url_components::omitted;
+    helpers::strip_trailing_spaces_from_opaque_path(*this);
+    ADA_ASSERT_TRUE(validate());
+    return;
+  }
+  if (!sorted) {
+    std::stable_sort(parameters, parameters + count, less);
+  }
+  // We append the new query after the old one and then erase the old one.
+  // Reserving first keeps the pointers into the old query valid.
+  size_t new_length = count - 1;
+  for (size_t i = 0; i < count; i++) {
+    new_length += parameters[i].length;
+  }
+  buffer.reserve(buffer.size() + new_length);
+  query = buffer.data() + query_start;
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) {
+      buffer += '&';
+    }
+    buffer.append(query + parameters[i].start, parameters[i].length);
+  }
+  buffer.erase(query_start, query_length);
+  ADA_ASSERT_TRUE(validate());
+}
+
+void url_aggregator::mask_search_values(const query_filter& keys,
+                                        std::string_view mask) {
+  ada_log("url_aggregator::mask_search_values ", buffer);
+  ADA_ASSERT_TRUE(validate());
+  if (components.search_start == url_components::omitted) {
+    return;
+  }
+  const uint32_t query_start = components.search_start + 1;
+  const uint32_t query_end = components.hash_start != url_components::omitted
+                                 ? components.hash_start
+                                 : uint32_t(buffer.size());
+  // Calls visit(start, end, masked) for every parameter of the query.
+  auto for_each_parameter = [&](auto visit) {
+    const char* query = buffer.data();
+    for (uint32_t start = query_start; start <= query_end;) {
+      const char* ampersand = static_cast<const char*>(
+          std::memchr(query + start, '&', query_end - start));
+      const uint32_t end = ampersand ? uint32_t(ampersand - query) : query_end;
+      const std::string_view pair(query + start, end - start);
+      const size_t equal = pair.find('=');
+      visit(start, end,
+            equal != std::string_view::npos &&
+                keys.contains(pair.substr(0, equal)),
+            equal);
+      start = end + 1;
+    }
+  };
+  size_t new_length = 0;
+  bool masked = false;
+  for_each_parameter(
+      [&](uint32_t start, uint32_t end, bool is_masked, size_t equal) {
+        new_length += is_masked ? equal + 1 + mask.size() : end - start;
+        new_length++;  // '&' or '#'
+        masked |= is_masked;
+      });
+  if (!masked) {
+    return;
+  }
+  new_length--;
+  // We append the new query, followed by the fragment, after the end of the
+  // buffer and then erase the old query and fragment. Reserving first keeps
+  // the pointers into the old query valid.
+  const uint32_t old_size = uint32_t(buffer.size());
+  buffer.reserve(old_size + new_length + (old_size - query_end));
+  for_each_parameter(
+      [&](uint32_t start, uint32_t end, bool is_masked, size_t equal) {
+        if (is_masked) {
+          buffer.append(buffer.data() + start, equal + 1);
+          buffer.append(mask);
+        } else {
+          buffer.append(buffer.data() + start, end - start);
+        }
+        if (end != query_end) {
+          buffer += '&';
+        }
+      });
+  buffer.append(buffer.data() + query_end, old_size - query_end);
+  buffer.erase(query_start, old_size - query_start);
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start = uint32_t(query_start + new_length);
+  }
+  ADA_ASSERT_TRUE(validate());
+}
+
 bool url_aggregator::set_href(const std::string_view input) {
   ADA_ASSERT_TRUE(!helpers::overlaps(input, buffer));
   ada_log("url_aggregator::set_href ", input, " [", input.size(), " bytes]");
@@ -467,7 +700,8 @@ bool url_aggregator::set_href(const std::string_view input) {
   return out.has_value();
 }
 
-ada_really_inline bool url_aggregator::parse_host(std::string_view input) {
+ada_really_inline bool url_aggregator::parse_host(
+    std::string_view input, const parse_options* options) {
   ada_log("url_aggregator:parse_host \"", input, "\" [", input.size(),
           " bytes]");
   ADA_ASSERT_TRUE(validate());
@@ -498,44 +732,88 @@ ada_really_inline bool url_aggregator::parse_host(std::string_view input) {
   // Let domain be the result of running UTF-8 decode without BOM on the
   // percent-decoding of input. Let asciiDomain be the result of running domain
   // to ASCII with domain and false. The most common case is an ASCII input, in
-  // which case we do not need to call the expensive 'to_ascii' if a few
-  // conditions are met: no '%' and no 'xn-' subsequence.
+  // which case we do not need to call the expensive 'to_ascii': classify_host
+  // tells us whether the host has a forbidden code point (including '%'), a
+  // non-ASCII byte or a label that starts with "xn--" (in any case).
 
   // Often, the input does not contain any forbidden code points, and no upper
   // case ASCII letter, then we can just copy it to the buffer. We want to
   // optimize for such a common case.
 
-  // Fast path: try to parse as pure decimal IPv4(a.b.c.d) first.
+  // With dotted_decimal_ipv4_only, a host that ends in a number is only
+  // accepted in the dotted-decimal form that the fast path below recognizes
+  // as canonical: the other number forms are never parsed. A host that only
+  // takes that form once percent-decoded or mapped by IDNA (e.g.,
+  // "%31%32%37.0.0.1" or fullwidth digits) is accepted as well.
+  const bool dotted_decimal_ipv4_only =
+      options != nullptr && options->dotted_decimal_ipv4_only;
+  auto is_dotted_decimal = [](std::string_view hostname) {
+    return (checkers::try_parse_ipv4_fast(hostname) &
+            (checkers::ipv4_fast_fail | checkers::ipv4_fast_reserialize)) == 0;
+  };
+
+  // Fast path: try to parse as an IPv4 address (a.b.c.d, 0x7f.1, ...) first.
   const uint64_t fast_result = checkers::try_parse_ipv4_fast(input);
-  if (fast_result < checkers::ipv4_fast_fail) {
-    // Fast path succeeded - input is pure decimal IPv4
-    if (!input.empty() && input.back() == '.') {
+  if ((fast_result & checkers::ipv4_fast_fail) == 0) {
+    if (fast_result & checkers::ipv4_fast_reserialize) {
+      if (dotted_decimal_ipv4_only) {
+        return is_valid = false;
+      }
+      // Hexadecimal, octal or short form: we have to reserialize it.
+      update_base_hostname(
+          ada::serializers::ipv4(uint32_t(fast_result & 0xFFFFFFFF)));
+    } else if (input.back() == '.') {
       update_base_hostname(input.substr(0, input.size() - 1));
     } else {
       update_base_hostname(input);
     }
     host_type = IPV4;
     is_valid = true;
-    ada_log("parse_host fast path decimal ipv4");
+    ada_log("parse_host fast path ipv4");
     ADA_ASSERT_TRUE(validate());
     return true;
   }
-  uint8_t is_forbidden_or_upper =
-      unicode::contains_forbidden_domain_code_point_or_upper(input.data(),
-                                                             input.size());
-  // Minor optimization opportunity:
-  // contains_forbidden_domain_code_point_or_upper could be extend to check for
-  // the presence of characters that cannot appear in the ipv4 address and we
-  // could also check whether x and n and - are present, and so we could skip
-  // some of the checks below. However, the gains are likely to be small, and
-  // the code would be more complex.
-  if (is_forbidden_or_upper == 0 &&
-      input.find("xn-") == std::string_view::npos) {
-    // fast path
-    update_base_hostname(input);
-
+  // Copy the input and classify it while lowering it in place: a single pass
+  // tells us whether it holds forbidden code points, non-ASCII bytes or a
+  // label starting with "xn--", and whether it might end in a number.
+  update_base_hostname(input);
+  char* host_data = buffer.data() + components.host_end - input.size();
+  uint8_t host_class = unicode::classify_host(host_data, input.size());
+  const size_t first_percent =
+      (host_class & unicode::host_forbidden) ? input.find('%')
+                                             : std::string_view::npos;
+  if (options != nullptr && options->reject_non_ascii_hosts &&
+      ((host_class & unicode::host_non_ascii) ||
+       first_percent != std::string_view::npos)) {
+    return is_valid = false;
+  }
+  if (first_percent != std::string_view::npos &&
+      (host_class & unicode::host_non_ascii) == 0) {
+    // An ASCII host only gets shorter when it is percent-decoded, so we decode
+    // it where it lands in the buffer and classify it again.
+    const uint32_t difference = uint32_t(
+        input.size() - unicode::percent_decode_in_place(
+                           host_data, input.size(), first_percent));
+    buffer.erase(components.host_end - difference, difference);
+    components.host_end -= difference;
+    components.pathname_start -= difference;
+    if (components.search_start != url_components::omitted) {
+      components.search_start -= difference;
+    }
+    if (components.hash_start != url_components::omitted) {
+      components.hash_start -= difference;
+    }
+    host_class = unicode::classify_host(host_data, input.size() - difference);
+  }
+  if ((host_class & (unicode::host_forbidden | unicode::host_non_ascii |
+                     unicode::host_has_xn_label)) == 0) {
+    // fast path: the lowered copy is the final host.
     // Check for other IPv4 formats (hex, octal, etc.)
-    if (checkers::is_ipv4(get_hostname())) {
+    if ((host_class & unicode::host_maybe_ipv4) &&
+        checkers::is_ipv4(get_hostname())) {
+      if (dotted_decimal_ipv4_only && !is_dotted_decimal(get_hostname())) {
+        return is_valid = false;
+      }
       ada_log("parse_host fast path ipv4");
       return parse_ipv4(get_hostname(), true);
     }
@@ -543,13 +821,17 @@ ada_really_inline bool url_aggregator::parse_host(std::string_view input) {
     is_valid = true;
     return true;
   }
-  // We have encountered at least one forbidden code point or the input contains
-  // 'xn-' (case insensitive), so we need to call 'to_ascii' to perform the full
-  // conversion.
+  // We have encountered at least one forbidden code point, a non-ASCII byte
+  // or a label that starts with "xn--", so we need 'to_ascii' to perform the
+  // full conversion. It works from the input as given (not from the lowered
+  // copy) and percent-decodes it itself when first_percent is set.
 
   ada_log("parse_host calling to_ascii");
-  std::optional<std::string> host = std::string(get_hostname());
-  is_valid = ada::unicode::to_ascii(host, input, input.find('%'));
+  // Without a forbidden code point, there is no '%' in the input. The result
+  // lives in a per-thread buffer until it is copied into ours.
+  std::optional<std::string_view> host =
+      ada::unicode::to_ascii(input, first_percent);
+  is_valid = host.has_value();
   if (!is_valid) {
     ada_log("parse_host to_ascii returns false");
     return is_valid = false;
@@ -557,19 +839,22 @@ ada_really_inline bool url_aggregator::parse_host(std::string_view input) {
   ada_log("parse_host to_ascii succeeded ", *host, " [", host->size(),
           " bytes]");
 
-  if (std::ranges::any_of(host.value(),
+  if (std::ranges::any_of(*host,
                           ada::unicode::is_forbidden_domain_code_point)) {
     return is_valid = false;
   }
 
   // If asciiDomain ends in a number, then return the result of IPv4 parsing
   // asciiDomain.
-  if (checkers::is_ipv4(host.value())) {
+  if (checkers::is_ipv4(*host)) {
+    if (dotted_decimal_ipv4_only && !is_dotted_decimal(*host)) {
+      return is_valid = false;
+    }
     ada_log("parse_host got ipv4 ", *host);
-    return parse_ipv4(host.value(), false);
+    return parse_ipv4(*host, false);
   }
 
-  update_base_hostname(host.value());
+  update_base_hostname(*host);
   ADA_ASSERT_TRUE(validate());
   return true;
 }
@@ -830,6 +1115,29 @@ bool url_aggregator::set_hostname(const std::string_view input) {
   return helpers::substring(buffer, start, components.host_end);
 }
 
+[[nodiscard]] std::optional<uint32_t> url_aggregator::get_ipv4_address()
+    const noexcept {
+  if (host_type != url_host_type::IPV4) {
+    return std::nullopt;
+  }
+  // The hostname is the canonical dotted-decimal serialization.
+  const uint64_t address = checkers::try_parse_ipv4_fast(get_hostname());
+  ADA_ASSERT_TRUE((address & checkers::ipv4_fast_fail) == 0);
+  return uint32_t(address & 0xFFFFFFFF);
+}
+
+[[nodiscard]] std::optional<std::array<uint16_t, 8>>
+url_aggregator::get_ipv6_address() const noexcept {
+  if (host_type != url_host_type::IPV6) {
+    return std::nullopt;
+  }
+  std::array<uint16_t, 8> address{};
+  if (!checkers::parse_serialized_ipv6(get_hostname(), address)) {
+    return std::nullopt;
+  }
+  return address;
+}
+
 [[nodiscard]] std::string_view url_aggregator::get_search() const
     ada_lifetime_bound {
   ada_log("url_aggregator::get_search");
@@ -1058,240 +1366,18 @@ final:
 }
 
 bool url_aggregator::parse_ipv6(std::string_view input) {
-  // TODO: Implement in_place optimization: we know that input points
-  // in the buffer, so we can just check whether the buffer is already
-  // well formatted.
-  // TODO: Find a way to merge parse_ipv6 with url.cpp implementation.
   ada_log("parse_ipv6 ", input, " [", input.size(), " bytes]");
   ADA_ASSERT_TRUE(validate());
   ADA_ASSERT_TRUE(!helpers::overlaps(input, buffer));
-  if (input.empty()) {
-    return is_valid = false;
-  }
-  // Let address be a new IPv6 address whose IPv6 pieces are all 0.
   std::array<uint16_t, 8> address{};
-
-  // Let pieceIndex be 0.
-  int piece_index = 0;
-
-  // Let compress be null.
-  std::optional<int> compress{};
-
-  // Let pointer be a pointer for input.
-  std::string_view::iterator pointer = input.begin();
-
-  // If c is U+003A (:), then:
-  if (input[0] == ':') {
-    // If remaining does not start with U+003A (:), validation error, return
-    // failure.
-    if (input.size() == 1 || input[1] != ':') {
-      ada_log("parse_ipv6 starts with : but the rest does not start with :");
-      return is_valid = false;
-    }
-
-    // Increase pointer by 2.
-    pointer += 2;
-
-    // Increase pieceIndex by 1 and then set compress to pieceIndex.
-    compress = ++piece_index;
-  }
-
-  // While c is not the EOF code point:
-  while (pointer != input.end()) {
-    // If pieceIndex is 8, validation error, return failure.
-    if (piece_index == 8) {
-      ada_log("parse_ipv6 piece_index == 8");
-      return is_valid = false;
-    }
-
-    // If c is U+003A (:), then:
-    if (*pointer == ':') {
-      // If compress is non-null, validation error, return failure.
-      if (compress.has_value()) {
-        ada_log("parse_ipv6 compress is non-null");
-        return is_valid = false;
-      }
-
-      // Increase pointer and pieceIndex by 1, set compress to pieceIndex, and
-      // then continue.
-      pointer++;
-      compress = ++piece_index;
-      continue;
-    }
-
-    // Let value and length be 0.
-    uint16_t value = 0, length = 0;
-
-    // While length is less than 4 and c is an ASCII hex digit,
-    // set value to value times 0x10 + c interpreted as hexadecimal number, and
-    // increase pointer and length by 1.
-    while (length < 4 && pointer != input.end() &&
-           unicode::is_ascii_hex_digit(*pointer)) {
-      // https://stackoverflow.com/questions/39060852/why-does-the-addition-of-two-shorts-return-an-int
-      value = uint16_t(value * 0x10 + unicode::convert_hex_to_binary(*pointer));
-      pointer++;
-      length++;
-    }
-
-    // If c is U+002E (.), then:
-    if (pointer != input.end() && *pointer == '.') {
-      // If length is 0, validation error, return failure.
-      if (length == 0) {
-        ada_log("parse_ipv6 length is 0");
-        return is_valid = false;
-      }
-
-      // Decrease pointer by length.
-      pointer -= length;
-
-      // If pieceIndex is greater than 6, validation error, return failure.
-      if (piece_index > 6) {
-        ada_log("parse_ipv6 piece_index > 6");
-        return is_valid = false;
-      }
-
-      // Let numbersSeen be 0.
-      int numbers_seen = 0;
-
-      // While c is not the EOF code point:
-      while (pointer != input.end()) {
-        // Let ipv4Piece be null.
-        std::optional<uint16_t> ipv4_piece{};
-
-        // If numbersSeen is greater than 0, then:
-        if (numbers_seen > 0) {
-          // If c is a U+002E (.) and numbersSeen is less than 4, then increase
-          // pointer by 1.
-          if (*pointer == '.' && numbers_seen < 4) {
-            pointer++;
-          } else {
-            // Otherwise, validation error, return failure.
-            ada_log("parse_ipv6 Otherwise, validation error, return failure");
-            return is_valid = false;
-          }
-        }
-
-        // If c is not an ASCII digit, validation error, return failure.
-        if (pointer == input.end() || !checkers::is_digit(*pointer)) {
-          ada_log(
-              "parse_ipv6 If c is not an ASCII digit, validation error, return "
-              "failure");
-          return is_valid = false;
-        }
-
-        // While c is an ASCII digit:
-        while (pointer != input.end() && checkers::is_digit(*pointer)) {
-          // Let number be c interpreted as decimal number.
-          int number = *pointer - '0';
-
-          // If ipv4Piece is null, then set ipv4Piece to number.
-          if (!ipv4_piece.has_value()) {
-            ipv4_piece = number;
-          }
-          // Otherwise, if ipv4Piece is 0, validation error, return failure.
-          else if (ipv4_piece == 0) {
-            ada_log("parse_ipv6 if ipv4Piece is 0, validation error");
-            return is_valid = false;
-          }
-          // Otherwise, set ipv4Piece to ipv4Piece times 10 + number.
-          else {
-            ipv4_piece = *ipv4_piece * 10 + number;
-          }
-
-          // If ipv4Piece is greater than 255, validation error, return failure.
-          if (ipv4_piece > 255) {
-            ada_log("parse_ipv6 ipv4_piece > 255");
-            return is_valid = false;
-          }
-
-          // Increase pointer by 1.
-          pointer++;
-        }
-
-        // Set address[pieceIndex] to address[pieceIndex] times 0x100 +
-        // ipv4Piece.
-        // https://stackoverflow.com/questions/39060852/why-does-the-addition-of-two-shorts-return-an-int
-        if (!ipv4_piece.has_value()) {
-          return is_valid = false;
-        }
-        address[piece_index] =
-            uint16_t(address[piece_index] * 0x100 + *ipv4_piece);
-
-        // Increase numbersSeen by 1.
-        numbers_seen++;
-
-        // If numbersSeen is 2 or 4, then increase pieceIndex by 1.
-        if (numbers_seen == 2 || numbers_seen == 4) {
-          piece_index++;
-        }
-      }
-
-      // If numbersSeen is not 4, validation error, return failure.
-      if (numbers_seen != 4) {
-        return is_valid = false;
-      }
-
-      // Break.
-      break;
-    }
-    // Otherwise, if c is U+003A (:):
-    else if ((pointer != input.end()) && (*pointer == ':')) {
-      // Increase pointer by 1.
-      pointer++;
-
-      // If c is the EOF code point, validation error, return failure.
-      if (pointer == input.end()) {
-        ada_log(
-            "parse_ipv6 If c is the EOF code point, validation error, return "
-            "failure");
-        return is_valid = false;
-      }
-    }
-    // Otherwise, if c is not the EOF code point, validation error, return
-    // failure.
-    else if (pointer != input.end()) {
-      ada_log(
-          "parse_ipv6 Otherwise, if c is not the EOF code point, validation "
-          "error, return failure");
-      return is_valid = false;
-    }
-
-    // Set address[pieceIndex] to value.
-    address[piece_index] = value;
-
-    // Increase pieceIndex by 1.
-    piece_index++;
-  }
-
-  // If compress is non-null, then:
-  if (compress.has_value()) {
-    // Let swaps be pieceIndex - compress.
-    int swaps = piece_index - *compress;
-
-    // Set pieceIndex to 7.
-    piece_index = 7;
-
-    // While pieceIndex is not 0 and swaps is greater than 0,
-    // swap address[pieceIndex] with address[compress + swaps - 1], and then
-    // decrease both pieceIndex and swaps by 1.
-    while (piece_index != 0 && swaps > 0) {
-      std::swap(address[piece_index], address[*compress + swaps - 1]);
-      piece_index--;
-      swaps--;
-    }
-  }
-  // Otherwise, if compress is null and pieceIndex is not 8, validation error,
-  // return failure.
-  else if (piece_index != 8) {
-    ada_log(
-        "parse_ipv6 if compress is null and pieceIndex is not 8, validation "
-        "error, return failure");
+  if (!checkers::parse_ipv6(input, address)) {
     return is_valid = false;
   }
-  // TODO: Optimization opportunity: Get rid of unnecessary string creation.
   // TODO: This is likely a bug because it goes back update_base_hostname, not
   // what we want to do.
-  update_base_hostname(ada::serializers::ipv6(address));
+  char serialized[ada::serializers::ipv6_max_length];
+  update_base_hostname(std::string_view(
+      serialized, ada::serializers::ipv6(address, serialized)));
   ada_log("parse_ipv6 ", get_hostname());
   ADA_ASSERT_TRUE(validate());
   host_type = IPV6;
@@ -1308,14 +1394,19 @@ bool url_aggregator::parse_opaque_host(std::string_view input) {
 
   // Return the result of running UTF-8 percent-encode on input using the C0
   // control percent-encode set.
-  size_t idx = ada::unicode::percent_encode_index(
-      input, character_sets::C0_CONTROL_PERCENT_ENCODE);
-  if (idx == input.size()) {
-    update_base_hostname(input);
-  } else {
-    // We only create a temporary string if we need to.
-    update_base_hostname(ada::unicode::percent_encode(
-        input, character_sets::C0_CONTROL_PERCENT_ENCODE, idx));
+  update_base_hostname(input);
+  // The host is encoded where it lands in the buffer, which is a no-op in the
+  // common case.
+  uint32_t difference = uint32_t(ada::unicode::percent_encode_in_place(
+      buffer, components.host_end - input.size(), input.size(),
+      character_sets::C0_CONTROL_PERCENT_ENCODE));
+  components.host_end += difference;
+  components.pathname_start += difference;
+  if (components.search_start != url_components::omitted) {
+    components.search_start += difference;
+  }
+  if (components.hash_start != url_components::omitted) {
+    components.hash_start += difference;
   }
   ADA_ASSERT_TRUE(validate());
   return true;
@@ -1497,13 +1588,11 @@ void url_aggregator::delete_dash_dot() {
 inline void url_aggregator::consume_prepared_path(std::string_view input) {
   ada_log("url_aggregator::consume_prepared_path ", input);
   /***
-   * This is largely duplicated code from helpers::parse_prepared_path, which is
-   * unfortunate. This particular function is nearly identical, except that it
-   * is a method on url_aggregator. The idea is that the trivial path (which is
-   * very common) merely appends to the buffer. This is the same trivial path as
-   * with helpers::parse_prepared_path, except that we have the additional check
-   * for is_at_path(). Otherwise, we grab a copy of the current path and we
-   * modify it, and then insert it back into the buffer.
+   * This mirrors helpers::parse_prepared_path. The trivial path (which is
+   * very common) merely appends to the buffer, as in
+   * helpers::parse_prepared_path, except that we have the additional check
+   * for is_at_path(). Otherwise, helpers::append_normalized_path resolves the
+   * dot segments directly at the end of the buffer.
    */
   uint8_t accumulator = checkers::path_signature(input);
   // Let us first detect a trivial case.
@@ -1511,9 +1600,9 @@ inline void url_aggregator::consume_prepared_path(std::string_view input) {
   // character needing percent encoding. Otherwise, we check that we have no %,
   // no dot, and no character needing percent encoding.
   constexpr uint8_t need_encoding = 1;
-  constexpr uint8_t backslash_char = 2;
   constexpr uint8_t dot_char = 4;
   constexpr uint8_t percent_char = 8;
+  constexpr uint8_t dot_segment = 16;
   bool special = type != ada::scheme::NOT_SPECIAL;
   bool may_need_slow_file_handling = (type == ada::scheme::type::FILE &&
                                       checkers::is_windows_drive_letter(input));
@@ -1522,15 +1611,21 @@ inline void url_aggregator::consume_prepared_path(std::string_view input) {
                : ((accumulator & (need_encoding | dot_char | percent_char)) ==
                   0)) &&
       (!may_need_slow_file_handling);
-  if (accumulator == dot_char && !may_need_slow_file_handling) {
+  if ((accumulator & ~dot_segment) == dot_char &&
+      !may_need_slow_file_handling) {
     // '4' means that we have at least one dot, but nothing that requires
     // percent encoding or decoding. The only part that is not trivial is
     // that we may have single dots and double dots path segments.
-    // If we have such segments, then we either have a path that begins
-    // with '.' (easy to check), or we have the sequence './'.
+    // If we have such segments, then some segment starts with a dot, which
+    // path_signature reports in the same sweep: without it, the dots are all
+    // within file names (e.g., "index.html") and the path is trivial.
+    // Otherwise, we either have a path that begins with '.' (easy to check),
+    // or we have the sequence './'.
     // Note: input cannot be empty, it must at least contain one character ('.')
     // Note: we know that '\' is not present.
-    if (input[0] != '.') {
+    if ((accumulator & dot_segment) == 0) {
+      trivial_path = true;
+    } else if (input[0] != '.') {
       size_t slashdot = 0;
       bool dot_is_file = true;
       for (;;) {
@@ -1553,122 +1648,51 @@ inline void url_aggregator::consume_prepared_path(std::string_view input) {
     buffer += input;
     return;
   }
-  std::string path = std::string(get_pathname());
-  // We are going to need to look a bit at the path, but let us see if we can
-  // ignore percent encoding *and* backslashes *and* percent characters.
-  // Except for the trivial case, this is likely to capture 99% of paths out
-  // there.
-  bool fast_path =
-      (special &&
-       (accumulator & (need_encoding | backslash_char | percent_char)) == 0) &&
-      (type != ada::scheme::type::FILE);
-  if (fast_path) {
-    ada_log("parse_prepared_path fast");
-    // Here we don't need to worry about \ or percent encoding.
-    // We also do not have a file protocol. We might have dots, however,
-    // but dots must as appear as '.', and they cannot be encoded because
-    // the symbol '%' is not present.
-    size_t previous_location = 0;  // We start at 0.
-    do {
-      size_t new_location = input.find('/', previous_location);
-      // std::string_view path_view = input;
-      //  We process the last segment separately:
-      if (new_location == std::string_view::npos) {
-        std::string_view path_view = input.substr(previous_location);
-        if (path_view == "..") {  // The path ends with ..
-          // e.g., if you receive ".." with an empty path, you go to "/".
-          if (path.empty()) {
-            path = '/';
-            update_base_pathname(path);
-            return;
-          }
-          // Fast case where we have nothing to do:
-          if (path.back() == '/') {
-            update_base_pathname(path);
-            return;
-          }
-          // If you have the path "/joe/myfriend",
-          // then you delete 'myfriend'.
-          path.resize(path.rfind('/') + 1);
-          update_base_pathname(path);
-          return;
-        }
-        path += '/';
-        if (path_view != ".") {
-          path.append(path_view);
-        }
-        update_base_pathname(path);
-        return;
-      } else {
-        // This is a non-final segment.
-        std::string_view path_view =
-            input.substr(previous_location, new_location - previous_location);
-        previous_location = new_location + 1;
-        if (path_view == "..") {
-          size_t last_delimiter = path.rfind('/');
-          if (last_delimiter != std::string::npos) {
-            path.erase(last_delimiter);
-          }
-        } else if (path_view != ".") {
-          path += '/';
-          path.append(path_view);
-        }
-      }
-    } while (true);
-  } else {
-    ada_log("parse_path slow");
-    // we have reached the general case
-    bool needs_percent_encoding = (accumulator & 1);
-    std::string path_buffer_tmp;
-    do {
-      size_t location = (special && (accumulator & 2))
-                            ? input.find_first_of("/\\")
-                            : input.find('/');
-      std::string_view path_view = input;
-      if (location != std::string_view::npos) {
-        path_view.remove_suffix(path_view.size() - location);
-        input.remove_prefix(location + 1);
-      }
-      // path_buffer is either path_view or it might point at a percent encoded
-      // temporary string.
-      std::string_view path_buffer =
-          (needs_percent_encoding &&
-           ada::unicode::percent_encode<false>(
-               path_view, character_sets::PATH_PERCENT_ENCODE, path_buffer_tmp))
-              ? path_buffer_tmp
-              : path_view;
-      if (unicode::is_double_dot_path_segment(path_buffer)) {
-        helpers::shorten_path(path, type);
-        if (location == std::string_view::npos) {
-          path += '/';
-        }
-      } else if (unicode::is_single_dot_path_segment(path_buffer) &&
-                 (location == std::string_view::npos)) {
-        path += '/';
-      }
-      // Otherwise, if path_buffer is not a single-dot path segment, then:
-      else if (!unicode::is_single_dot_path_segment(path_buffer)) {
-        // If url's scheme is "file", url's path is empty, and path_buffer is a
-        // Windows drive letter, then replace the second code point in
-        // path_buffer with U+003A (:).
-        if (type == ada::scheme::type::FILE && path.empty() &&
-            checkers::is_windows_drive_letter(path_buffer)) {
-          path += '/';
-          path += path_buffer[0];
-          path += ':';
-          path_buffer.remove_prefix(2);
-          path.append(path_buffer);
-        } else {
-          // Append path_buffer to url's path.
-          path += '/';
-          path.append(path_buffer);
-        }
-      }
-      if (location == std::string_view::npos) {
-        update_base_pathname(path);
-        return;
-      }
-    } while (true);
+  // The path is edited in place at the end of the buffer, which is where it
+  // always is while parsing. A setter may have a search and a hash after it:
+  // we set them aside in the meantime.
+  std::string suffix;
+  const uint32_t saved_search_start = components.search_start;
+  const uint32_t saved_hash_start = components.hash_start;
+  const uint32_t pathname_end =
+      components.pathname_start + get_pathname_length();
+  if (pathname_end != buffer.size()) {
+    suffix.assign(buffer, pathname_end);
+    buffer.resize(pathname_end);
+    components.search_start = url_components::omitted;
+    components.hash_start = url_components::omitted;
+  }
+  const size_t start = components.pathname_start;
+  const bool had_dash_dot = has_dash_dot();
+  helpers::append_normalized_path(input, type,
+                                  (accumulator & need_encoding) != 0, buffer,
+                                  start);
+  // Same as update_base_pathname, once the path is in place.
+  const bool begins_with_dashdash =
+      std::string_view(buffer).substr(start).starts_with("//");
+  if (!begins_with_dashdash && had_dash_dot) {
+    // We must delete the ./
+    buffer.erase(components.host_end, 2);
+    components.pathname_start -= 2;
+  }
+  if (begins_with_dashdash && !has_opaque_path && !has_authority() &&
+      !had_dash_dot) {
+    // If url's host is null, url does not have an opaque path, url's path's
+    // size is greater than 1, then append U+002F (/) followed by U+002E (.)
+    // to output.
+    buffer.insert(components.pathname_start, "/.");
+    components.pathname_start += 2;
   }
+  if (!suffix.empty()) {
+    uint32_t difference = uint32_t(buffer.size()) - pathname_end;
+    if (saved_search_start != url_components::omitted) {
+      components.search_start = saved_search_start + difference;
+    }
+    if (saved_hash_start != url_components::omitted) {
+      components.hash_start = saved_hash_start + difference;
+    }
+    buffer.append(suffix);
+  }
+  ADA_ASSERT_TRUE(validate());
 }
 }  // namespace ada
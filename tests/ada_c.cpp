@@ -36,6 +36,36 @@ TEST(ada_c, ada_parse) {
   SUCCEED();
 }
 
+TEST(ada_c, ada_parse_into) {
+  std::string_view invalid = "not a url";
+  ada_url url = ada_parse(invalid.data(), invalid.length());
+  ASSERT_FALSE(ada_is_valid(url));
+
+  std::string_view first = "https://www.example.com/first?query";
+  ASSERT_TRUE(ada_parse_into(url, first.data(), first.length()));
+  ASSERT_TRUE(ada_is_valid(url));
+  ASSERT_EQ(convert_string(ada_get_href(url)), first);
+
+  std::string_view second = "HTTP://Example.org:80/second";
+  ASSERT_TRUE(ada_parse_into(url, second.data(), second.length()));
+  ASSERT_EQ(convert_string(ada_get_href(url)), "http://example.org/second");
+
+  ASSERT_FALSE(ada_parse_into(url, invalid.data(), invalid.length()));
+  ASSERT_FALSE(ada_is_valid(url));
+
+  // Valid, invalid and valid again.
+  ASSERT_TRUE(ada_parse_into(url, first.data(), first.length()));
+  ASSERT_FALSE(ada_parse_into(url, invalid.data(), invalid.length()));
+  ASSERT_FALSE(ada_is_valid(url));
+  ASSERT_TRUE(ada_parse_into(url, second.data(), second.length()));
+  ASSERT_TRUE(ada_is_valid(url));
+  ASSERT_EQ(convert_string(ada_get_href(url)), "http://example.org/second");
+
+  ada_free(url);
+
+  SUCCEED();
+}
+
 TEST(ada_c, ada_parse_with_base) {
   std::string_view input = "/hello";
   std::string_view base =
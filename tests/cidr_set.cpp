@@ -0,0 +1,143 @@
+#include "ada.h"
+#include "gtest/gtest.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+TEST(cidr_set, empty) {
+  ada::cidr_set set;
+  ASSERT_TRUE(set.empty());
+  ASSERT_FALSE(set.contains(uint32_t(0)));
+  ASSERT_FALSE(set.contains(std::array<uint16_t, 8>{}));
+  SUCCEED();
+}
+
+TEST(cidr_set, parse_prefixes) {
+  ada::cidr_set set;
+  ASSERT_TRUE(set.add("10.0.0.0/8"));
+  ASSERT_TRUE(set.add("192.168.1.1"));
+  ASSERT_TRUE(set.add("172.16.0.0/12"));
+  ASSERT_TRUE(set.add("fe80::/10"));
+  ASSERT_TRUE(set.add("[::1]"));
+  ASSERT_TRUE(set.add("2001:DB8::/32"));
+  ASSERT_EQ(set.size(), 6);
+  for (std::string_view invalid :
+       {"", "/8", "10.0.0.0/", "10.0.0.0/33", "10.0.0.0/8x", "10/8",
+        "0x0a.0.0.0/8", "10.0.0.0./8", "::1/129", "::1::2/64", "[::1",
+        "example.com/8"}) {
+    ASSERT_FALSE(set.add(invalid)) << invalid;
+  }
+  ASSERT_EQ(set.size(), 6);
+  SUCCEED();
+}
+
+TEST(cidr_set, ipv4_addresses) {
+  ada::cidr_set set;
+  ASSERT_TRUE(set.add("10.0.0.0/8"));
+  ASSERT_TRUE(set.add("172.16.0.0/12"));
+  ASSERT_TRUE(set.add("192.168.1.1/32"));
+  ASSERT_TRUE(set.add("100.64.0.0/10"));
+  ASSERT_TRUE(set.contains(uint32_t(0x0a000000)));
+  ASSERT_TRUE(set.contains(uint32_t(0x0affffff)));
+  ASSERT_FALSE(set.contains(uint32_t(0x0b000000)));
+  ASSERT_TRUE(set.contains(uint32_t(0xac1f0001)));  // 172.31.0.1
+  ASSERT_FALSE(set.contains(uint32_t(0xac200001)));  // 172.32.0.1
+  ASSERT_TRUE(set.contains(uint32_t(0xc0a80101)));
+  ASSERT_FALSE(set.contains(uint32_t(0xc0a80102)));
+  ASSERT_TRUE(set.contains(uint32_t(0x647fffff)));  // 100.127.255.255
+  ASSERT_FALSE(set.contains(uint32_t(0x64800000)));  // 100.128.0.0
+  SUCCEED();
+}
+
+TEST(cidr_set, default_route) {
+  ada::cidr_set set;
+  ASSERT_TRUE(set.add("0.0.0.0/0"));
+  ASSERT_TRUE(set.contains(uint32_t(0)));
+  ASSERT_TRUE(set.contains(uint32_t(0xffffffff)));
+  ASSERT_FALSE(set.contains(std::array<uint16_t, 8>{0x2001, 0xdb8}));
+  ASSERT_TRUE(set.add("::/0"));
+  ASSERT_TRUE(set.contains(std::array<uint16_t, 8>{0x2001, 0xdb8}));
+  SUCCEED();
+}
+
+TEST(cidr_set, urls) {
+  ada::cidr_set set;
+  ASSERT_TRUE(set.add("127.0.0.0/8"));
+  ASSERT_TRUE(set.add("::1/128"));
+  ASSERT_TRUE(set.add("fc00::/7"));
+  for (std::string_view input :
+       {"http://127.0.0.1/", "http://0x7f.1/", "http://2130706433:8080/",
+        "http://[::1]/", "https://[fd12:3456::1]/",
+        "http://[::ffff:127.0.0.2]/"}) {
+    auto aggregator = ada::parse<ada::url_aggregator>(input);
+    ASSERT_TRUE(aggregator) << input;
+    ASSERT_TRUE(set.contains(*aggregator)) << input;
+    auto url = ada::parse<ada::url>(input);
+    ASSERT_TRUE(url) << input;
+    ASSERT_TRUE(set.contains(*url)) << input;
+  }
+  for (std::string_view input :
+       {"http://128.0.0.1/", "http://localhost/", "http://[::2]/",
+        "http://[fe00::1]/", "file:///etc/passwd"}) {
+    auto aggregator = ada::parse<ada::url_aggregator>(input);
+    ASSERT_TRUE(aggregator) << input;
+    ASSERT_FALSE(set.contains(*aggregator)) << input;
+    auto url = ada::parse<ada::url>(input);
+    ASSERT_TRUE(url) << input;
+    ASSERT_FALSE(set.contains(*url)) << input;
+  }
+  SUCCEED();
+}
+
+TEST(cidr_set, numeric_host_accessors) {
+  auto ipv4 = ada::parse<ada::url_aggregator>("http://0xc0.0xa8.1/");
+  ASSERT_TRUE(ipv4);
+  ASSERT_EQ(ipv4->get_ipv4_address(), uint32_t(0xc0a80001));
+  ASSERT_FALSE(ipv4->get_ipv6_address().has_value());
+  auto ipv6 = ada::parse<ada::url>("http://[2001:db8::8:800:200c:417a]/");
+  ASSERT_TRUE(ipv6);
+  ASSERT_FALSE(ipv6->get_ipv4_address().has_value());
+  std::array<uint16_t, 8> expected{0x2001, 0xdb8, 0,      0,
+                                   8,      0x800, 0x200c, 0x417a};
+  ASSERT_EQ(ipv6->get_ipv6_address(), expected);
+  auto domain = ada::parse<ada::url_aggregator>("http://example.com/");
+  ASSERT_TRUE(domain);
+  ASSERT_FALSE(domain->get_ipv4_address().has_value());
+  ASSERT_FALSE(domain->get_ipv6_address().has_value());
+  SUCCEED();
+}
+
+// Compares the trie against a linear scan over many random prefixes, which
+// exercises the relocation and compaction of nodes.
+TEST(cidr_set, random_ipv4_prefixes) {
+  std::mt19937 rng(1234);
+  ada::cidr_set set;
+  std::vector<std::pair<uint32_t, uint32_t>> prefixes;  // (network, mask)
+  for (size_t i = 0; i < 5000; i++) {
+    uint32_t address = rng();
+    uint8_t length = uint8_t(8 + rng() % 25);
+    uint32_t mask = uint32_t(~uint64_t(0) << (32 - length));
+    ASSERT_TRUE(set.add(address, length));
+    prefixes.emplace_back(address & mask, mask);
+  }
+  for (size_t i = 0; i < 20000; i++) {
+    uint32_t address = rng();
+    // Make sure that we also probe addresses that do match.
+    if (i % 2 == 0) {
+      auto [network, mask] = prefixes[i % prefixes.size()];
+      address = network | (address & ~mask);
+    }
+    bool expected = false;
+    for (auto [network, mask] : prefixes) {
+      if ((address & mask) == network) {
+        expected = true;
+        break;
+      }
+    }
+    ASSERT_EQ(set.contains(address), expected) << address;
+  }
+  SUCCEED();
+}
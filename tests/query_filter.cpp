@@ -0,0 +1,104 @@
+#include "ada.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <string_view>
+
+TEST(query_filter, empty) {
+  ada::query_filter filter;
+  ASSERT_TRUE(filter.empty());
+  ASSERT_FALSE(filter.contains(""));
+  ASSERT_FALSE(filter.contains("utm_source"));
+  SUCCEED();
+}
+
+TEST(query_filter, keys_and_prefixes) {
+  ada::query_filter filter;
+  filter.add("utm_*");
+  filter.add("fbclid");
+  filter.add("gclid");
+  filter.add("fbclid");
+  ASSERT_EQ(filter.size(), 3);
+  for (std::string_view key :
+       {"utm_source", "utm_medium", "utm_", "fbclid", "gclid"}) {
+    ASSERT_TRUE(filter.contains(key)) << key;
+  }
+  for (std::string_view key :
+       {"", "utm", "UTM_source", "fbclid2", "fbcli", "gclids", "a", "utm%5F"}) {
+    ASSERT_FALSE(filter.contains(key)) << key;
+  }
+  filter.add("");
+  ASSERT_TRUE(filter.contains(""));
+  filter.add("*");
+  ASSERT_TRUE(filter.contains("anything"));
+  ASSERT_EQ(filter.size(), 5);
+  SUCCEED();
+}
+
+TEST(query_filter, canonicalize_for_cache) {
+  ada::query_filter filter;
+  filter.add("utm_*");
+  filter.add("fbclid");
+  struct test_case {
+    std::string_view input;
+    std::string_view expected;
+  };
+  for (auto [input, expected] : std::initializer_list<test_case>{
+           {"https://example.com/?b=2&a=1#top", "https://example.com/?a=1&b=2"},
+           {"https://example.com/?a=1&b=2", "https://example.com/?a=1&b=2"},
+           {"https://example.com/p?utm_source=x&fbclid=y",
+            "https://example.com/p"},
+           {"https://example.com/p?#x", "https://example.com/p"},
+           {"https://example.com/p?&&", "https://example.com/p"},
+           {"https://example.com/p?c=3&&a=1&utm_medium=m&b",
+            "https://example.com/p?a=1&b&c=3"},
+           {"https://example.com/p?a=2&b=0&a=1",
+            "https://example.com/p?a=2&a=1&b=0"},
+           {"https://example.com/%2f%aB?k=%e2%82%ac&%zz=1",
+            "https://example.com/%2F%AB?%zz=1&k=%E2%82%AC"},
+           {"https://example.com/p?x=%", "https://example.com/p?x=%"},
+           {"non-special://host/p?z&y#f", "non-special://host/p?y&z"},
+           {"data:text/plain,a?utm_x#f", "data:text/plain,a"}}) {
+    auto url = ada::parse<ada::url_aggregator>(input);
+    ASSERT_TRUE(url) << input;
+    url->canonicalize_for_cache(&filter);
+    ASSERT_EQ(url->get_href(), expected) << input;
+    ASSERT_TRUE(url->validate()) << input;
+    // The result is canonical: parsing it again gives the same URL.
+    auto reparsed = ada::parse<ada::url_aggregator>(url->get_href());
+    ASSERT_TRUE(reparsed) << input;
+    ASSERT_EQ(reparsed->get_href(), expected) << input;
+  }
+  auto url = ada::parse<ada::url_aggregator>("https://example.com/?b&utm_x");
+  ASSERT_TRUE(url);
+  url->canonicalize_for_cache();
+  ASSERT_EQ(url->get_href(), "https://example.com/?b&utm_x");
+  SUCCEED();
+}
+
+// More parameters than fit on the stack.
+TEST(query_filter, canonicalize_many_parameters) {
+  std::string input = "https://example.com/?";
+  std::string expected = "https://example.com/?";
+  for (int i = 99; i >= 0; i--) {
+    const std::string n = std::to_string(i);
+    input.append("k").append(n).append("=").append(n).append("&");
+    input.append("utm_").append(n).append("&");
+  }
+  for (int i = 0; i < 100; i++) {
+    const std::string n = std::to_string(i);
+    expected.append("k").append(n).append("=").append(n).append("&");
+  }
+  // The keys sort as strings: k0, k1, k10, k11, ...
+  auto expected_url = ada::parse<ada::url>(expected);
+  ada::url_search_params params(expected_url->get_search());
+  params.sort();
+  ada::query_filter filter;
+  filter.add("utm_*");
+  auto url = ada::parse<ada::url_aggregator>(input);
+  ASSERT_TRUE(url);
+  url->canonicalize_for_cache(&filter);
+  ASSERT_EQ(url->get_search(), "?" + params.to_string());
+  ASSERT_TRUE(url->validate());
+  SUCCEED();
+}
@@ -86,10 +86,10 @@ TEST(wpt_url_tests, idna_test_v2_to_ascii) {
           std::string(std::string_view(simdjson::to_json_string(object)));
       std::string_view input = object["input"].get_string();
 
-      std::optional<std::string> output;
-      ada::unicode::to_ascii(output, input, input.find('%'));
+      std::string output;
+      bool is_valid = ada::unicode::to_ascii(output, input, input.find('%'));
       auto expected_output = object["output"];
-      auto given_output = output.has_value() ? output.value() : "";
+      auto given_output = is_valid ? output : "";
 
       if (expected_output.is_null()) {
         ASSERT_EQ(given_output, "");
@@ -270,20 +270,19 @@ TYPED_TEST(wpt_url_tests_typed, toascii_encoding) {
             std::string(std::string_view(simdjson::to_json_string(object)));
 
         std::string_view input = object["input"];
-        std::optional<std::string> output;
-        ada::unicode::to_ascii(output, input, input.find('%'));
+        std::string output;
+        bool is_valid = ada::unicode::to_ascii(output, input, input.find('%'));
         auto expected_output = object["output"];
 
         // The following code replicates `toascii.window.js` from web-platform
         // tests.
         // @see
         // https://github.com/web-platform-tests/wpt/blob/master/url/toascii.window.js
-        if (output.has_value()) {
+        if (is_valid) {
           std::string_view stringified_output = expected_output.get_string();
-          ASSERT_EQ(output.value(), stringified_output);
+          ASSERT_EQ(output, stringified_output);
 
-          std::string url_string =
-              "https://" + std::string(output.value()) + "/x";
+          std::string url_string = "https://" + output + "/x";
           auto current = ada::parse<TypeParam>(url_string);
 
           if (expected_output.type() == ondemand::json_type::string) {
@@ -460,6 +459,76 @@ TYPED_TEST(wpt_url_tests_typed, urltestdata_encoding) {
   SUCCEED();
 }
 
+// Converting between the two representations must give the same result as
+// parsing into the other representation directly.
+TEST(wpt_url_tests, urltestdata_conversion) {
+  size_t counter{};
+  for (auto source : {URLTESTDATA_JSON, ADA_URLTESTDATA_JSON}) {
+    ondemand::parser parser;
+    ASSERT_TRUE(file_exists(source));
+    padded_string json = padded_string::load(source);
+    ondemand::document doc = parser.iterate(json);
+    for (auto element : doc.get_array()) {
+      if (element.type() != ondemand::json_type::object) {
+        continue;
+      }
+      ondemand::object object = element.get_object();
+      std::string_view input = object["input"].get_string(true);
+      std::string_view base;
+      std::optional<ada::url_aggregator> base_aggregator;
+      std::optional<ada::url> base_url;
+      if (!object["base"].get(base)) {
+        auto parsed_aggregator = ada::parse<ada::url_aggregator>(base);
+        auto parsed_url = ada::parse<ada::url>(base);
+        if (!parsed_aggregator || !parsed_url) {
+          continue;
+        }
+        base_aggregator = *parsed_aggregator;
+        base_url = *parsed_url;
+      }
+      auto aggregator = ada::parse<ada::url_aggregator>(
+          input, base_aggregator ? &*base_aggregator : nullptr);
+      if (!aggregator) {
+        continue;
+      }
+      auto url = ada::parse<ada::url>(input, base_url ? &*base_url : nullptr);
+      ASSERT_TRUE(url) << input;
+
+      ada::url converted_url(*aggregator);
+      ASSERT_EQ(converted_url.get_href(), url->get_href()) << input;
+      ASSERT_EQ(converted_url.get_protocol(), url->get_protocol()) << input;
+      ASSERT_EQ(converted_url.get_username(), url->get_username()) << input;
+      ASSERT_EQ(converted_url.get_password(), url->get_password()) << input;
+      ASSERT_EQ(converted_url.host, url->host) << input;
+      ASSERT_EQ(converted_url.port, url->port) << input;
+      ASSERT_EQ(converted_url.path, url->path) << input;
+      ASSERT_EQ(converted_url.query, url->query) << input;
+      ASSERT_EQ(converted_url.hash, url->hash) << input;
+      ASSERT_EQ(converted_url.has_opaque_path, url->has_opaque_path) << input;
+      ASSERT_EQ(converted_url.host_type, url->host_type) << input;
+      ASSERT_EQ(converted_url.type, url->type) << input;
+
+      ada::url_aggregator converted_aggregator(*url);
+      ASSERT_TRUE(converted_aggregator.validate()) << input;
+      ASSERT_EQ(converted_aggregator.get_href(), aggregator->get_href())
+          << input;
+      ASSERT_EQ(converted_aggregator.get_components().to_string(),
+                aggregator->get_components().to_string())
+          << input;
+      ASSERT_EQ(converted_aggregator.has_opaque_path,
+                aggregator->has_opaque_path)
+          << input;
+      ASSERT_EQ(converted_aggregator.host_type, aggregator->host_type)
+          << input;
+      ASSERT_EQ(converted_aggregator.type, aggregator->type) << input;
+      counter++;
+    }
+  }
+  std::cout << "Tests executed = " << counter << std::endl;
+  ASSERT_GT(counter, 0);
+  SUCCEED();
+}
+
 TEST(wpt_url_tests, verify_dns_length) {
   const char* source = VERIFYDNSLENGTH_TESTS_JSON;
   size_t counter{};